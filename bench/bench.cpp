@@ -0,0 +1,290 @@
+#include "corpus.hpp"
+
+#include "source.hpp"
+#include "lexer.hpp"
+#include "token_stream.hpp"
+#include "parcer.hpp"
+#include "visitor.hpp"
+#include "ast_cache.hpp"
+#include "resolver.hpp"
+#include "folder.hpp"
+#include "eval.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+// обходит все дерево и считает узлы: замер чистой стоимости обхода без вывода
+struct CountVisitor : ASTVisitor {
+    std::size_t nodes = 0;
+
+    void walk(ASTNode* node) { if (node) node->accept(*this); }
+
+    void visit(TernaryExprNode& node) override { ++nodes; walk(node.condition); walk(node.true_expr); walk(node.false_expr); }
+    void visit(BinaryExprNode& node) override { ++nodes; walk(node.left); walk(node.right); }
+    void visit(UnaryExprNode& node) override { ++nodes; walk(node.operand); }
+    void visit(AssignExprNode& node) override { ++nodes; walk(node.left); walk(node.right); }
+    void visit(PostfixExprNode& node) override { ++nodes; walk(node.operand); }
+    void visit(LiteralExprNode&) override { ++nodes; }
+    void visit(IdExprNode&) override { ++nodes; }
+    void visit(MemberAccessExprNode& node) override { ++nodes; walk(node.object); }
+    void visit(CallExprNode& node) override { ++nodes; walk(node.called); for (auto& arg : node.arguments) walk(arg); }
+    void visit(ArrayAccessExprNode& node) override { ++nodes; walk(node.array); walk(node.index); }
+    void visit(ArrayInitExprNode& node) override { ++nodes; for (auto& element : node.elements) walk(element); }
+
+    void visit(ReturnStatmNode& node) override { ++nodes; walk(node.expr); }
+    void visit(BreakStatmNode&) override { ++nodes; }
+    void visit(ContinueStatmNode&) override { ++nodes; }
+    void visit(ConditionStatmNode& node) override { ++nodes; walk(node.condition); walk(node.then_statm); walk(node.else_statm); }
+    void visit(ExprStatmNode& node) override { ++nodes; walk(node.expr); }
+    void visit(BlockStatmNode& node) override { ++nodes; for (auto& statm : node.statements) walk(statm); }
+    void visit(ForStatmNode& node) override { ++nodes; walk(node.init); walk(node.condition); walk(node.incr); walk(node.body); }
+    void visit(WhileStatmNode& node) override { ++nodes; walk(node.condition); walk(node.body); }
+    void visit(InputStatmNode& node) override { ++nodes; walk(node.expr); }
+    void visit(OutStatmNode& node) override { ++nodes; walk(node.expr); }
+    void visit(SZFStatmNode& node) override { ++nodes; walk(node.expr); }
+    void visit(ExitStatmNode& node) override { ++nodes; walk(node.expr); }
+
+    void visit(VarDeclNode& node) override {
+        ++nodes;
+        for (auto& var : node.variables) { walk(var.init); walk(var.size); }
+    }
+    void visit(FuncDeclNode& node) override { ++nodes; walk(node.body); }
+    void visit(StructDeclNode& node) override { ++nodes; for (auto field : node.fields) walk(field); }
+    void visit(AssertDeclNode& node) override { ++nodes; walk(node.expr); }
+
+    void visit(ASTRootNode& node) override { ++nodes; for (auto& statm : node.statements) walk(statm); }
+};
+
+struct Options {
+    std::size_t bytes = 4 << 20;
+    std::size_t depth = 32;
+    int repeat = 5;
+    std::string shape;      // пусто - все формы
+};
+
+// тот же подсчет через walk(): без рекурсии, operator() только считает,
+// переход к потомкам - switch по kind вместо accept + visit
+struct StaticCounter {
+    std::size_t nodes = 0;
+
+    template <typename Node>
+    void operator()(Node&) { ++nodes; }
+};
+
+long peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// лучшее время из repeat запусков; prepare выполняется перед каждым вне замера
+template <typename F, typename P>
+double best_of(int repeat, F&& run, P&& prepare) {
+    double best = 1e300;
+    for (int i = 0; i < repeat; ++i) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+template <typename F>
+double best_of(int repeat, F&& run) {
+    return best_of(repeat, run, [] {});
+}
+
+// одна строка JSON на замер, чтобы результаты можно было сравнивать между коммитами
+void report(std::string_view shape, std::string_view phase, std::size_t bytes, std::size_t tokens,
+            std::size_t nodes, double seconds, std::size_t ast_bytes = 0) {
+    std::cout << "{\"shape\":\"" << shape << "\",\"phase\":\"" << phase << "\""
+              << ",\"bytes\":" << bytes << ",\"tokens\":" << tokens << ",\"nodes\":" << nodes
+              << ",\"ast_kb\":" << ast_bytes / 1024
+              << ",\"seconds\":" << seconds
+              << ",\"mb_per_s\":" << bytes / seconds / 1e6
+              << ",\"tokens_per_s\":" << tokens / seconds
+              << ",\"nodes_per_s\":" << nodes / seconds
+              << ",\"peak_rss_kb\":" << peak_rss_kb() << "}" << std::endl;
+}
+
+void run(const ShapeInfo& info, const Options& options) {
+    SourceBuffer source(generate(info.shape, options.bytes, options.depth));
+
+    std::size_t tokens = 0;
+    double lex = best_of(options.repeat, [&] {
+        Lexer lexer(source);
+        tokens = lexer.tokenize().size();
+    });
+
+    TokenStream stream(source);
+    std::unique_ptr<AstArena> arena;
+    ASTNode* root = nullptr;
+    double parse = best_of(options.repeat, [&] {
+        Parcer parcer(stream, *arena);
+        parcer.parce();
+        root = parcer.getASTRoot();
+    }, [&] { arena = std::make_unique<AstArena>(); });  // освобождение прошлого дерева не входит в замер
+
+    std::unique_ptr<AstArena> parallel_arena;
+    double parse_parallel = best_of(options.repeat, [&] {
+        Parcer parcer(stream, *parallel_arena);
+        parcer.parce_parallel();
+    }, [&] { parallel_arena = std::make_unique<AstArena>(); });
+
+    // ленивые тела: разбор файла плюс первые CALLED функций, как при запуске,
+    // который вызывает лишь несколько из тысяч
+    constexpr std::size_t CALLED = 10;
+    std::unique_ptr<AstArena> lazy_arena;
+    double parse_lazy = best_of(options.repeat, [&] {
+        Parcer parcer(stream, *lazy_arena);
+        parcer.set_lazy_bodies(true);
+        parcer.parce();
+        std::size_t called = 0;
+        for (auto* decl : static_cast<ASTRootNode*>(parcer.getASTRoot())->statements) {
+            auto* func = dynamic_cast<FuncDeclNode*>(decl);
+            if (func && called++ < CALLED) Parcer::parce_body(stream, *lazy_arena, *func);
+        }
+    }, [&] { lazy_arena = std::make_unique<AstArena>(); });
+
+    std::size_t nodes = 0;
+    double traverse = best_of(options.repeat, [&] {
+        CountVisitor counter;
+        root->accept(counter);
+        nodes = counter.nodes;
+    });
+
+    // правка в середине файла ("= x" -> "= 1 + x") и повторный разбор только задетого объявления
+    double reparse = 0;
+    std::size_t reparsed_nodes = 0;
+    std::size_t edit_at = source.view().find(" = ", source.size() / 2);
+    if (edit_at != std::string_view::npos) {
+        AstArena base_arena;
+        Parcer base(stream, base_arena);
+        base.parce();
+        SourceEdit edit{edit_at + 3, 0, "1 + "};
+        auto edited = source.edited(edit);
+        std::vector<Token> edited_tokens = Lexer(source).tokenize();
+        auto change = Lexer::relex(source, *edited, edited_tokens, edit);
+        TokenStream edited_stream(*edited, edited_tokens);
+        std::unique_ptr<AstArena> reparse_arena;
+        reparse = best_of(options.repeat, [&] {
+            Parcer parcer(edited_stream, *reparse_arena);
+            parcer.reparce(base, change);
+        }, [&] { reparse_arena = std::make_unique<AstArena>(); });
+        reparsed_nodes = reparse_arena->nodes();
+    }
+
+    // теплый запуск с кэшем: дерево из уже прочитанного файла кэша вместо лексера и парсера
+    std::string cached = ast_cache::serialize(*root);
+    std::unique_ptr<AstArena> cache_arena;
+    double cache_load = best_of(options.repeat, [&] {
+        ast_cache::deserialize(cached, *cache_arena);
+    }, [&] { cache_arena = std::make_unique<AstArena>(); });
+
+    std::size_t static_nodes = 0;
+    double traverse_static = best_of(options.repeat, [&] {
+        StaticCounter counter;
+        walk(*root, counter);
+        static_nodes = counter.nodes;
+    });
+    if (static_nodes != nodes) throw std::runtime_error("walk насчитал другое число узлов");
+
+    report(info.name, "lex", source.size(), tokens, 0, lex);
+    report(info.name, "parse", source.size(), tokens, nodes, parse, arena->reserved());
+    report(info.name, "parse_parallel", source.size(), tokens, nodes, parse_parallel, parallel_arena->reserved());
+    report(info.name, "parse_lazy", source.size(), tokens, lazy_arena->nodes(), parse_lazy, lazy_arena->reserved());
+    if (reparse > 0) report(info.name, "reparse", source.size(), 0, reparsed_nodes, reparse);
+    report(info.name, "cache_load", cached.size(), 0, cache_arena->nodes(), cache_load, cache_arena->reserved());
+    report(info.name, "traverse", source.size(), 0, nodes, traverse);
+    report(info.name, "traverse_static", source.size(), 0, nodes, traverse_static);
+}
+
+// выполнение одной программы обходом дерева и на байткоде; вывод обоих должен совпасть
+void execute(const ProgramInfo& info, const Options& options) {
+    SourceBuffer source{std::string(info.source)};
+    AstArena arena;
+    Lexer lexer(source);
+    Parcer parcer(lexer, arena);
+    parcer.parce();
+    auto* root = static_cast<ASTRootNode*>(parcer.getASTRoot());
+    // walk, а не CountVisitor: рекурсия по глубокому выражению из corpus переполнила бы стек
+    std::size_t nodes = 0;
+    walk(*root, [&nodes](auto&) { ++nodes; });
+    Program program = Resolver().resolve(*root);
+    // свертка меняет дерево, так что она одна и без повторов
+    std::size_t removed = 0;
+    double fold = best_of(1, [&] { removed = Folder(program, arena).fold(*root); });
+
+    std::istringstream in;
+    std::ostringstream ast_out;
+    double eval_ast = best_of(options.repeat, [&] {
+        EvalVisitor(program, in, ast_out).run(*root);
+    }, [&] { ast_out.str(""); });
+
+    Module module;
+    double compile_time = best_of(options.repeat, [&] { module = compile(program, *root); });
+    std::size_t instructions = 0;
+    for (const auto& function : module.functions) instructions += function.code.size();
+
+    std::ostringstream vm_out;
+    double eval_vm = best_of(options.repeat, [&] {
+        VM(module, in, vm_out).run();
+    }, [&] { vm_out.str(""); });
+    if (vm_out.str() != ast_out.str()) throw std::runtime_error("VM и дерево вывели разное в " + std::string(info.name));
+
+    // число выбранных инструкций - отдельным запуском со счетчиком, на время eval_vm он не влияет
+    std::ostringstream counted_out;
+    VM counted(module, in, counted_out);
+    double dispatch = best_of(1, [&] { counted.run(true); });
+
+    report(info.name, "fold", source.size(), 0, removed, fold);
+    report(info.name, "eval_ast", source.size(), 0, nodes, eval_ast);
+    report(info.name, "compile", source.size(), 0, instructions, compile_time);
+    report(info.name, "eval_vm", source.size(), 0, instructions, eval_vm);
+    report(info.name, "vm_dispatch", source.size(), 0, counted.dispatches(), dispatch);
+}
+
+// bench [--size МБ] [--depth N] [--repeat N] [--shape имя] [--dump имя]
+int main(int argc, char* argv[]) {
+    Options options;
+    std::string dump;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--size") options.bytes = static_cast<std::size_t>(std::stod(value) * (1 << 20));
+        else if (arg == "--depth") options.depth = std::stoul(value);
+        else if (arg == "--repeat") options.repeat = std::stoi(value);
+        else if (arg == "--shape") options.shape = value;
+        else if (arg == "--dump") dump = value;
+        else {
+            std::cerr << "неизвестный параметр: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        for (const auto& info : shapes()) {
+            if (!dump.empty()) {
+                if (info.name == dump) std::cout << generate(info.shape, options.bytes, options.depth);
+                continue;
+            }
+            if (options.shape.empty() || info.name == options.shape) run(info, options);
+        }
+        for (const auto& info : programs()) {
+            if (dump.empty() && (options.shape.empty() || info.name == options.shape)) execute(info, options);
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Ошибка: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "corpus.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+class Generator {
+public:
+    Generator(std::size_t depth, unsigned seed) : depth(depth), rng(seed) {}
+
+    std::string out;
+
+    void expression(std::size_t level) {
+        if (level == 0) {
+            operand();
+            return;
+        }
+        static const char* ops[] = {" + ", " - ", " * ", " / ", " < ", " == ", " && ", " || "};
+        // вложенность растет по левой ветке, справа - лист или короткое поддерево,
+        // так что размер выражения линеен по глубине
+        out += '(';
+        expression(level - 1);
+        out += ops[rng() % 8];
+        if (rng() % 4 == 0) out += '-';
+        if (rng() % 4 == 0) expression(std::min<std::size_t>(level - 1, 2));
+        else operand();
+        out += ')';
+    }
+
+    void operand() {
+        switch (rng() % 4) {
+            case 0: out += "a"; break;
+            case 1: out += std::to_string(rng() % 1000); break;
+            case 2: out += std::to_string(rng() % 100) + ".5"; break;
+            default: out += "b"; break;
+        }
+    }
+
+    void expressions_unit(std::size_t n) {
+        out += "int expr_" + std::to_string(n) + "(int a, int b) {\n    int r = ";
+        expression(depth);
+        out += ";\n    return r;\n}\n";
+    }
+
+    void function_unit(std::size_t n) {
+        std::string name = "func_" + std::to_string(n);
+        out += "int " + name + "(int a, float b) {\n";
+        out += "    int s = a * " + std::to_string(n % 97) + " + 1;\n";
+        out += "    for (int i = 0; i < " + std::to_string(rng() % 50 + 1) + "; i++) {\n";
+        out += "        s = s + i;\n    }\n";
+        out += "    if (s > a && b != 1.0) {\n        print(s);\n    } else {\n        s = a ? s : -s;\n    }\n";
+        out += "    while (s > 100) {\n        s = s / 2;\n    }\n";
+        if (n > 0) out += "    s = func_" + std::to_string(n - 1) + "(s, b);\n";
+        out += "    return s;\n}\n";
+    }
+
+    void struct_unit(std::size_t n) {
+        std::string name = "Rec" + std::to_string(n);
+        out += "struct " + name + " {\n";
+        std::size_t fields = rng() % 8 + 2;
+        for (std::size_t f = 0; f < fields; ++f) {
+            static const char* types[] = {"int", "float", "char", "bool"};
+            out += "    " + std::string(types[f % 4]) + " f" + std::to_string(f) + ";\n";
+        }
+        out += "};\n";
+        out += "void use_" + name + "() {\n    " + name + " r;\n";
+        for (std::size_t f = 0; f < fields; ++f) {
+            out += "    r.f" + std::to_string(f) + " = r.f" + std::to_string((f + 1) % fields) + ";\n";
+        }
+        out += "    read(r.f0);\n}\n";
+    }
+
+    void comment_unit(std::size_t n) {
+        out += "// line comment " + std::to_string(n) + ": this function does nothing interesting at all\n";
+        out += "/* block comment\n * spanning several lines\n * with some words in it, number " + std::to_string(n) + "\n */\n";
+        out += "int c_" + std::to_string(n) + "() { // trailing comment\n";
+        out += "    /* inline */ int x = 1; // more\n    return x;\n}\n";
+    }
+
+    void string_unit(std::size_t n) {
+        out += "void s_" + std::to_string(n) + "() {\n    print(\"";
+        std::size_t length = rng() % 400 + 100;
+        for (std::size_t i = 0; i < length; ++i) out += static_cast<char>('a' + rng() % 26);
+        out += "\");\n}\n";
+    }
+
+private:
+    std::size_t depth;
+    std::mt19937 rng;
+};
+
+}
+
+const std::vector<ShapeInfo>& shapes() {
+    static const std::vector<ShapeInfo> all = {
+        {Shape::EXPRESSIONS, "expressions"},
+        {Shape::FUNCTIONS, "functions"},
+        {Shape::STRUCTS, "structs"},
+        {Shape::COMMENTS, "comments"},
+        {Shape::STRINGS, "strings"},
+    };
+    return all;
+}
+
+std::string generate(Shape shape, std::size_t bytes, std::size_t depth, unsigned seed) {
+    Generator gen(depth, seed);
+    gen.out.reserve(bytes + 4096);
+    for (std::size_t n = 0; gen.out.size() < bytes; ++n) {
+        switch (shape) {
+            case Shape::EXPRESSIONS: gen.expressions_unit(n); break;
+            case Shape::FUNCTIONS: gen.function_unit(n); break;
+            case Shape::STRUCTS: gen.struct_unit(n); break;
+            case Shape::COMMENTS: gen.comment_unit(n); break;
+            case Shape::STRINGS: gen.string_unit(n); break;
+        }
+    }
+    return gen.out;
+}
+
+const std::vector<ProgramInfo>& programs() {
+    // одно выражение из 100000 слагаемых: ни один проход от Resolver до выполнения не должен
+    // спускаться по нему рекурсией. слагаемые - переменная, чтобы свертка не убрала дерево
+    static const std::string deep = [] {
+        std::string source = "int main() {\n    int one = 1;\n    int x = one";
+        for (int i = 1; i < 100000; ++i) source += " + one";
+        return source + ";\n    print(x);\n    return 0;\n}\n";
+    }();
+    static const std::vector<ProgramInfo> all = {
+        {"loops", R"(
+int main() {
+    int s = 0;
+    for (int i = 0; i < 2000; i++) {
+        for (int j = 0; j < 1000; j++) {
+            s = s + (i ^ j) % 7;
+        }
+    }
+    print(s);
+    return 0;
+}
+)"},
+        {"fib", R"(
+int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+int main() {
+    print(fib(27));
+    return 0;
+}
+)"},
+        {"sieve", R"(
+int main() {
+    int n = 200000;
+    int count = 0;
+    for (int round = 0; round < 3; round++) {
+        bool composite[200001];
+        count = 0;
+        for (int i = 2; i <= n; i++) {
+            if (!composite[i]) {
+                count++;
+                for (int j = i + i; j <= n; j += i) composite[j] = true;
+            }
+        }
+    }
+    print(count);
+    return 0;
+}
+)"},
+        {"floats", R"(
+int main() {
+    float x = 0;
+    float step = 0.5;
+    int i = 0;
+    while (i < 1000000) {
+        x = x * 0.999 + step;
+        i = i + 1;
+    }
+    print(x);
+    return 0;
+}
+)"},
+        {"fields", R"(
+struct Pair { int a; int b; };
+int main() {
+    Pair p;
+    p.a = 0;
+    p.b = 1;
+    for (int i = 0; i < 500000; i++) {
+        p.a = p.a + p.b;
+        p.b = p.a - p.b;
+        if (p.a > 100000) p.a = p.a % 1000;
+    }
+    print(p.a);
+    return 0;
+}
+)"},
+        {"consts", R"(
+const int N = 100 * 1000 * 10;
+const int MASK = (1 << 10) - 1;
+const bool TRACE = false;
+int main() {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+        if (TRACE) print(i);
+        sum = sum + (i & MASK) * (2 + 3);
+        while (TRACE && sum) sum = 0;
+    }
+    print(sum);
+    return 0;
+}
+)"},
+        {"deep", deep},
+    };
+    return all;
+}
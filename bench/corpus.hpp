@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// синтетические программы на языке, который принимает Parcer
+enum class Shape {
+    EXPRESSIONS,    // глубоко вложенные выражения
+    FUNCTIONS,      // много маленьких функций с ветвлениями и циклами
+    STRUCTS,        // структуры и обращения к полям
+    COMMENTS,       // код, в котором большая часть текста - комментарии
+    STRINGS,        // длинные строковые литералы
+};
+
+struct ShapeInfo {
+    Shape shape;
+    std::string_view name;
+};
+
+const std::vector<ShapeInfo>& shapes();
+
+// генерирует не меньше bytes байт; depth - глубина вложенности для EXPRESSIONS
+std::string generate(Shape shape, std::size_t bytes, std::size_t depth = 32, unsigned seed = 1);
+
+// программы с main для замера выполнения: циклы, вызовы, массивы и поля
+struct ProgramInfo {
+    std::string_view name;
+    std::string_view source;
+};
+
+const std::vector<ProgramInfo>& programs();
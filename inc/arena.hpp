@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+// bump-аллокатор для узлов AST одного разбора. узлы и их списки (std::pmr::vector)
+// лежат в крупных блоках арены и ссылаются друг на друга обычными указателями;
+// деструкторы узлов не вызываются, вся память освобождается разом вместе с ареной
+class AstArena : public std::pmr::memory_resource {
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        ++count;
+        return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // дочерняя арена для другого потока разбора: выделять из нее может только он,
+    // а живет и освобождается она вместе с этой. создавать дочерние - из одного потока
+    AstArena& fork() {
+        children.push_back(std::make_unique<AstArena>());
+        return *children.back();
+    }
+
+    // счетчики - вместе с дочерними аренами
+    std::size_t nodes() const noexcept { return total(&AstArena::count); }        // создано узлов
+    std::size_t used() const noexcept { return total(&AstArena::bytes_used); }     // байт выдано
+    std::size_t reserved() const noexcept { return total(&AstArena::bytes_reserved); } // байт в блоках
+
+private:
+    static constexpr std::size_t FIRST_BLOCK = 64 * 1024;
+    static constexpr std::size_t MAX_BLOCK = 8 * 1024 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::vector<std::unique_ptr<AstArena>> children;
+    std::byte* cursor = nullptr;
+    std::byte* limit = nullptr;
+    std::size_t next_block = FIRST_BLOCK;
+    std::size_t count = 0;
+    std::size_t bytes_used = 0;
+    std::size_t bytes_reserved = 0;
+
+    std::size_t total(std::size_t AstArena::* counter) const noexcept {
+        std::size_t sum = this->*counter;
+        for (const auto& child : children) sum += child->total(counter);
+        return sum;
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
@@ -1,249 +1,292 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <memory>
+#include <memory_resource>
 #include <variant>
 
+#include "symbol.hpp"
+#include "token.hpp"
+
 struct ASTVisitor;
 
+// имена в узлах - Symbol из глобальной таблицы, операторы - OpKind; в SourceBuffer
+// смотрят только строковые литералы, так что он должен пережить дерево.
+// узлы живут в AstArena и связаны обычными указателями, списки - std::pmr::vector из той же арены
+
 // добавить DeclStatement - то же самое, что и ExpressionStatement только для decl
 
+// поля slot, depth, field, function и frame_size заполняет Resolver (resolver.hpp) перед
+// выполнением; до этого в них UNRESOLVED
+inline constexpr std::uint32_t UNRESOLVED = ~std::uint32_t(0);
+
+// вид узла для статической диспетчеризации visit<F> (visitor.hpp) без виртуальных вызовов
+enum class NodeKind : std::uint8_t {
+    TERNARY, BINARY, UNARY, ASSIGN, POSTFIX, LITERAL, ID, MEMBER_ACCESS, CALL, ARRAY_ACCESS, ARRAY_INIT,
+    RETURN, BREAK, CONTINUE, CONDITION, EXPR_STATM, BLOCK, FOR, WHILE, INPUT, OUT, SIZEOF, EXIT,
+    VAR_DECL, FUNC_DECL, STRUCT_DECL, ASSERT_DECL,
+    ROOT,
+};
+
 struct ASTNode {
+    const NodeKind kind;
+    explicit ASTNode(NodeKind kind) : kind(kind) {}
     virtual ~ASTNode() = default;
     virtual void accept(ASTVisitor& visitor) = 0;
 };
 
 struct DeclNode : ASTNode {
+    using ASTNode::ASTNode;
     virtual ~DeclNode() = default;
     virtual void accept(ASTVisitor& visitor) override = 0;
 };
 
 struct ExprNode : ASTNode {
+    using ASTNode::ASTNode;
     virtual ~ExprNode() = default;
     virtual void accept(ASTVisitor& visitor) override = 0;
 };
 
 struct StatmNode : ASTNode {
+    using ASTNode::ASTNode;
     virtual ~StatmNode() = default;
     virtual void accept(ASTVisitor& visitor) override = 0;
 };
 
 struct TernaryExprNode : ExprNode{
-    std::shared_ptr<ExprNode> condition;
-    std::shared_ptr<ExprNode> true_expr;
-    std::shared_ptr<ExprNode> false_expr;
-    TernaryExprNode(std::shared_ptr<ExprNode> condition, std::shared_ptr<ExprNode> true_expr, std::shared_ptr<ExprNode> false_expr) :
-        condition(std::move(condition)), true_expr(std::move(true_expr)), false_expr(std::move(false_expr)) {}
+    ExprNode* condition;
+    ExprNode* true_expr;
+    ExprNode* false_expr;
+    TernaryExprNode(ExprNode* condition, ExprNode* true_expr, ExprNode* false_expr) :
+        ExprNode(NodeKind::TERNARY), condition(condition), true_expr(true_expr), false_expr(false_expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct BinaryExprNode : ExprNode{
-    std::string oper;
-    std::shared_ptr<ExprNode> left;
-    std::shared_ptr<ExprNode> right;
-    BinaryExprNode(const std::string& oper, std::shared_ptr<ExprNode> left, std::shared_ptr<ExprNode> right) :
-        oper(oper), left(std::move(left)), right(std::move(right)) {}
+    OpKind oper;
+    ExprNode* left;
+    ExprNode* right;
+    BinaryExprNode(OpKind oper, ExprNode* left, ExprNode* right) :
+        ExprNode(NodeKind::BINARY), oper(oper), left(left), right(right) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct UnaryExprNode : ExprNode{
-    std::string oper;
-    std::shared_ptr<ExprNode> operand;
-    UnaryExprNode(const std::string& oper, std::shared_ptr<ExprNode> operand) :
-        oper(oper), operand(std::move(operand)) {}
+    OpKind oper;
+    ExprNode* operand;
+    UnaryExprNode(OpKind oper, ExprNode* operand) :
+        ExprNode(NodeKind::UNARY), oper(oper), operand(operand) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct AssignExprNode : ExprNode{
-    std::shared_ptr<ExprNode> left;
-    std::shared_ptr<ExprNode> right;
-    AssignExprNode(std::shared_ptr<ExprNode> left, std::shared_ptr<ExprNode> right) :
-        left(std::move(left)), right(std::move(right)) {}
+    OpKind oper;    // ASSIGN или составное, ADD_ASSIGN и т.п.
+    ExprNode* left;
+    ExprNode* right;
+    AssignExprNode(OpKind oper, ExprNode* left, ExprNode* right) :
+        ExprNode(NodeKind::ASSIGN), oper(oper), left(left), right(right) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct PostfixExprNode : ExprNode{
-    std::string oper;
-    std::shared_ptr<ExprNode> operand;
-    PostfixExprNode(const std::string& oper, std::shared_ptr<ExprNode> operand) :
-        oper(oper), operand(std::move(operand)) {}
+    OpKind oper;
+    ExprNode* operand;
+    PostfixExprNode(OpKind oper, ExprNode* operand) :
+        ExprNode(NodeKind::POSTFIX), oper(oper), operand(operand) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct LiteralExprNode : ExprNode{
-    std::variant<int, double, bool, char, std::string> value;
-    explicit LiteralExprNode(std::variant<int, double, bool, char, std::string> value) :
-        value(value) {}
+    std::variant<int, double, bool, char, std::string_view> value;
+    explicit LiteralExprNode(std::variant<int, double, bool, char, std::string_view> value) :
+        ExprNode(NodeKind::LITERAL), value(std::move(value)) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct IdExprNode : ExprNode{
-    std::string name;
-    explicit IdExprNode(const std::string& name) :
-        name(name) {}
+    Symbol name;
+    std::uint16_t depth = 0;            // 0 - глобальная переменная, иначе локальная в кадре функции
+    std::uint32_t slot = UNRESOLVED;    // номер ячейки среди глобальных или в кадре
+    explicit IdExprNode(Symbol name) :
+        ExprNode(NodeKind::ID), name(name) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct MemberAccessExprNode : ExprNode{
-    std::shared_ptr<ExprNode> object;
-    std::string member;
-    MemberAccessExprNode(std::shared_ptr<ExprNode> object, const std::string& member) :
-        object(std::move(object)), member(member) {}
+    ExprNode* object;
+    Symbol member;
+    std::uint32_t field = UNRESOLVED;   // номер поля в структуре
+    MemberAccessExprNode(ExprNode* object, Symbol member) :
+        ExprNode(NodeKind::MEMBER_ACCESS), object(object), member(member) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct CallExprNode : ExprNode {
-    std::shared_ptr<ExprNode> called;
-    std::vector<std::shared_ptr<ExprNode>> arguments;
-    explicit CallExprNode(std::shared_ptr<ExprNode> called, std::vector<std::shared_ptr<ExprNode>> arguments) :
-        called(called), arguments(arguments) {}
+    ExprNode* called;
+    std::pmr::vector<ExprNode*> arguments;
+    std::uint32_t function = UNRESOLVED;    // номер в Program::functions
+    explicit CallExprNode(ExprNode* called, std::pmr::vector<ExprNode*> arguments) :
+        ExprNode(NodeKind::CALL), called(called), arguments(std::move(arguments)) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ArrayAccessExprNode : ExprNode{
-    std::shared_ptr<ExprNode> array;
-    std::shared_ptr<ExprNode> index;
-    ArrayAccessExprNode(std::shared_ptr<ExprNode> array, std::shared_ptr<ExprNode> index) :
-        array(std::move(array)), index(std::move(index)) {}
+    ExprNode* array;
+    ExprNode* index;
+    ArrayAccessExprNode(ExprNode* array, ExprNode* index) :
+        ExprNode(NodeKind::ARRAY_ACCESS), array(array), index(index) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ArrayInitExprNode : ExprNode {
-    std::vector<std::shared_ptr<ExprNode>> elements;
-    ArrayInitExprNode(std::vector<std::shared_ptr<ExprNode>> elements) :
-        elements(std::move(elements)) {}
+    std::pmr::vector<ExprNode*> elements;
+    ArrayInitExprNode(std::pmr::vector<ExprNode*> elements) :
+        ExprNode(NodeKind::ARRAY_INIT), elements(std::move(elements)) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ReturnStatmNode : StatmNode {
-    std::shared_ptr<StatmNode> expr;
-    ReturnStatmNode(std::shared_ptr<StatmNode> expr = nullptr) :
-        expr(std::move(expr)) {}
+    StatmNode* expr;
+    ReturnStatmNode(StatmNode* expr = nullptr) :
+        StatmNode(NodeKind::RETURN), expr(expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct BreakStatmNode : StatmNode {
+    BreakStatmNode() : StatmNode(NodeKind::BREAK) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ContinueStatmNode : StatmNode {
+    ContinueStatmNode() : StatmNode(NodeKind::CONTINUE) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ConditionStatmNode : StatmNode {
-    std::shared_ptr<ExprNode> condition;
-    std::shared_ptr<StatmNode> then_statm;
-    std::shared_ptr<StatmNode> else_statm;
-    ConditionStatmNode(std::shared_ptr<ExprNode> condition, std::shared_ptr<StatmNode> then_statm, std::shared_ptr<StatmNode> else_statm = nullptr) :
-        condition(std::move(condition)), then_statm(std::move(then_statm)), else_statm(std::move(else_statm)) {}
+    ExprNode* condition;
+    StatmNode* then_statm;
+    StatmNode* else_statm;
+    ConditionStatmNode(ExprNode* condition, StatmNode* then_statm, StatmNode* else_statm = nullptr) :
+        StatmNode(NodeKind::CONDITION), condition(condition), then_statm(then_statm), else_statm(else_statm) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ExprStatmNode : StatmNode {
-    std::shared_ptr<ASTNode> expr;
-    explicit ExprStatmNode(std::shared_ptr<ASTNode> expr) :
-        expr(std::move(expr)) {}
+    ASTNode* expr;
+    explicit ExprStatmNode(ASTNode* expr) :
+        StatmNode(NodeKind::EXPR_STATM), expr(expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct BlockStatmNode : StatmNode {
-    std::vector<std::shared_ptr<StatmNode>> statements;
+    std::pmr::vector<StatmNode*> statements;
+    explicit BlockStatmNode(std::pmr::vector<StatmNode*> statements) :
+        StatmNode(NodeKind::BLOCK), statements(std::move(statements)) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ForStatmNode : StatmNode {
-    std::shared_ptr<DeclNode> init; // decl statement or expr
-    std::shared_ptr<ExprNode> condition;
-    std::shared_ptr<ExprNode> incr;
-    std::shared_ptr<StatmNode> body;
-    ForStatmNode(std::shared_ptr<DeclNode> init, std::shared_ptr<ExprNode> condition, std::shared_ptr<ExprNode> incr, std::shared_ptr<StatmNode> body) :
-        init(std::move(init)), condition(std::move(condition)), incr(std::move(incr)), body(std::move(body)) {}
+    ASTNode* init;      // объявление переменных или выражение, как в ExprStatmNode
+    ExprNode* condition;
+    ExprNode* incr;
+    StatmNode* body;
+    ForStatmNode(ASTNode* init, ExprNode* condition, ExprNode* incr, StatmNode* body) :
+        StatmNode(NodeKind::FOR), init(init), condition(condition), incr(incr), body(body) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct WhileStatmNode : StatmNode {
-    std::shared_ptr<ExprNode> condition;
-    std::shared_ptr<StatmNode> body;
-    WhileStatmNode(std::shared_ptr<ExprNode> condition, std::shared_ptr<StatmNode> body) :
-        condition(std::move(condition)), body(std::move(body)) {}
+    ExprNode* condition;
+    StatmNode* body;
+    bool do_while;      // do body while (condition): тело выполняется до первой проверки
+    WhileStatmNode(ExprNode* condition, StatmNode* body, bool do_while = false) :
+        StatmNode(NodeKind::WHILE), condition(condition), body(body), do_while(do_while) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct InputStatmNode : StatmNode {
-    std::shared_ptr<StatmNode> expr;
-    InputStatmNode(std::shared_ptr<StatmNode> expr) :
-        expr(std::move(expr)) {}
+    StatmNode* expr;
+    InputStatmNode(StatmNode* expr) :
+        StatmNode(NodeKind::INPUT), expr(expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct OutStatmNode : StatmNode {
-    std::shared_ptr<StatmNode> expr;
-    OutStatmNode(std::shared_ptr<StatmNode> expr) :
-        expr(std::move(expr)) {}
+    StatmNode* expr;
+    OutStatmNode(StatmNode* expr) :
+        StatmNode(NodeKind::OUT), expr(expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct SZFStatmNode : StatmNode { // sizof это опреатор, сделать его оператором
-    std::shared_ptr<ExprNode> expr;
-    SZFStatmNode(std::shared_ptr<ExprNode> expr) :
-        expr(std::move(expr)) {}
+    ExprNode* expr;
+    SZFStatmNode(ExprNode* expr) :
+        StatmNode(NodeKind::SIZEOF), expr(expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ExitStatmNode : StatmNode {
-    std::shared_ptr<ExprNode> expr;
-    ExitStatmNode(std::shared_ptr<ExprNode> expr) :
-        expr(std::move(expr)) {}
+    ExprNode* expr;
+    ExitStatmNode(ExprNode* expr) :
+        StatmNode(NodeKind::EXIT), expr(expr) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct VariableNode { 
-    std::string name;
-    std::shared_ptr<ExprNode> init;
-    std::shared_ptr<ExprNode> size;
-    VariableNode(const std::string& name, std::shared_ptr<ExprNode> init, std::shared_ptr<ExprNode> size) :
-        name(name), init(std::move(init)), size(std::move(size)) {}
+    Symbol name;
+    ExprNode* init;
+    ExprNode* size;
+    std::uint16_t depth = 0;            // как у IdExprNode
+    std::uint32_t slot = UNRESOLVED;
+    VariableNode(Symbol name, ExprNode* init, ExprNode* size) :
+        name(name), init(init), size(size) {}
 };
 
 struct VarDeclNode : DeclNode {
-    std::string type;
-    std::vector<VariableNode> variables;
-    VarDeclNode(const std::string& type, std::vector<VariableNode> variables) :
-        type(type), variables(std::move(variables)) {}
+    Symbol type;
+    std::pmr::vector<VariableNode> variables;
+    bool constant;      // const: менять нельзя, начальное значение обязательно
+    VarDeclNode(Symbol type, std::pmr::vector<VariableNode> variables, bool constant = false) :
+        DeclNode(NodeKind::VAR_DECL), type(type), variables(std::move(variables)), constant(constant) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct FuncDeclNode : DeclNode {
-    std::string func_type;
-    std::string func_name;
-    std::vector<std::pair<std::string, std::string>> parameters;
-    std::shared_ptr<BlockStatmNode> body;
-    FuncDeclNode(const std::string& func_type, const std::string& func_name, const std::vector<std::pair<std::string, std::string>>& parameters, std::shared_ptr<BlockStatmNode> body = nullptr) :
-        func_type(func_type), func_name(func_name), parameters(parameters), body(std::move(body)) {}
+    Symbol func_type;
+    Symbol func_name;
+    std::pmr::vector<std::pair<Symbol, Symbol>> parameters; // тип, имя
+    BlockStatmNode* body;
+    // ленивое тело: токены [body_first, body_last) в TokenStream, разбираются Parcer::parce_body
+    std::uint32_t body_first = 0;
+    std::uint32_t body_last = 0;
+    std::uint32_t frame_size = 0;       // ячеек в кадре: параметры и все локальные переменные
+    FuncDeclNode(Symbol func_type, Symbol func_name, std::pmr::vector<std::pair<Symbol, Symbol>> parameters, BlockStatmNode* body = nullptr) :
+        DeclNode(NodeKind::FUNC_DECL), func_type(func_type), func_name(func_name), parameters(std::move(parameters)), body(body) {}
+    bool pending() const { return !body && body_first != body_last; }   // тело есть, но еще не разобрано
     void accept(ASTVisitor& visitor) override;
 };
 
 struct StructDeclNode : DeclNode {
-    std::string name;
-    std::vector<VarDeclNode> fields;
-    StructDeclNode(const std::string& name, const std::vector<VarDeclNode>& fields) :
-        name(name), fields(fields) {}
+    Symbol name;
+    std::pmr::vector<VarDeclNode*> fields;
+    StructDeclNode(Symbol name, std::pmr::vector<VarDeclNode*> fields) :
+        DeclNode(NodeKind::STRUCT_DECL), name(name), fields(std::move(fields)) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct AssertDeclNode : DeclNode {
-    std::shared_ptr<ExprNode> expr;
-    std::string message;
-    AssertDeclNode(std::shared_ptr<ExprNode> expr, std::string message) :
-        expr(std::move(expr)), message(message) {}
+    ExprNode* expr;
+    std::string_view message;
+    AssertDeclNode(ExprNode* expr, std::string_view message) :
+        DeclNode(NodeKind::ASSERT_DECL), expr(expr), message(message) {}
     void accept(ASTVisitor& visitor) override;
 };
 
 struct ASTRootNode : ASTNode{
-    std::vector<std::shared_ptr<ASTNode>> statements;
-    ASTRootNode() = default;
-    ASTRootNode(std::vector<std::shared_ptr<ASTNode>> statements) :
-        statements(std::move(statements)) {}
+    std::pmr::vector<ASTNode*> statements;
+    ASTRootNode(std::pmr::vector<ASTNode*> statements) :
+        ASTNode(NodeKind::ROOT), statements(std::move(statements)) {}
     void accept(ASTVisitor& visitor) override;
 };
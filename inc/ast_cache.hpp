@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ast.hpp"
+#include "arena.hpp"
+#include "source.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// двоичный формат дерева для кэша между запусками. файл не зависит от адреса загрузки:
+//   заголовок  "ASTCACHE", u32 версия, u32 число узлов, u32 число строк, u32 0, u64 смещение строк
+//   записи     u8 вид узла и поля; ссылка на ребенка - u32 расстояние назад в записях (0 - нет),
+//              имя или строка - u32 номер в таблице строк, списки - u32 длина и элементы
+//   строки     u32 длина и байты, по порядку номеров
+// дети записаны раньше родителя, корень - последняя запись, так что загрузка идет одним
+// проходом по файлу без рекурсии. числа - в порядке байт машины, как и ключ кэша
+namespace ast_cache {
+
+inline constexpr std::uint32_t FORMAT_VERSION = 3;
+inline constexpr std::string_view MAGIC = "ASTCACHE";
+inline constexpr std::size_t HEADER_SIZE = 32;
+
+enum Record : std::uint8_t {
+    TERNARY, BINARY, UNARY, ASSIGN, POSTFIX, LITERAL, ID, MEMBER, CALL, INDEX, ARRAY_INIT,
+    RETURN, BREAK, CONTINUE, CONDITION, EXPR_STATM, BLOCK, FOR, WHILE, INPUT, OUT, SIZEOF, EXIT,
+    VAR_DECL, FUNC_DECL, STRUCT_DECL, ASSERT,
+    ROOT,
+};
+
+enum LiteralTag : std::uint8_t { INT, DOUBLE, BOOL, CHAR, STRING };
+
+inline constexpr std::uint32_t NO_STRING = ~std::uint32_t(0);
+
+std::string serialize(ASTNode& root);
+
+// узлы создаются в arena одним проходом по data; data после загрузки не нужна -
+// имена и строки переходят в глобальную таблицу символов. битый файл - std::runtime_error
+ASTRootNode* deserialize(std::string_view data, AstArena& arena);
+
+}
+
+// кэш деревьев в каталоге: файл называется по хэшу текста программы и версии
+// формата вместе с версией компилятора, так что старые записи просто не находятся
+class AstCache {
+public:
+    explicit AstCache(std::string directory);
+
+    ASTRootNode* load(const SourceBuffer& source, AstArena& arena) const;  // nullptr - нет в кэше или запись битая
+    void store(const SourceBuffer& source, ASTNode& root) const;
+    std::string path(const SourceBuffer& source) const;
+
+private:
+    std::string directory;
+};
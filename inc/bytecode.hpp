@@ -0,0 +1,158 @@
+#pragma once
+
+#include "ast.hpp"
+#include "resolver.hpp"
+#include "value.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// регистровый байткод. кадр функции: [локальные по слотам Resolver | временные | константы];
+// константы копируются в свои регистры при вызове, так что операнд - всегда регистр.
+// X(имя, a, b, c) - виды операндов для дизассемблера и компилятора:
+//   R регистр, N число, I число со знаком, T TypeId, F номер функции, _ нет; G глобальная, J переход
+//   и M сообщение ассерта занимают b и c вместе (Instr::wide)
+#define VM_OPCODES(X) \
+    X(MOVE, R, R, _)            /* R[a] = R[b] */ \
+    X(STORE, R, R, _)           /* R[a] = R[b] с приведением к типу R[a], см. values::assign */ \
+    X(CAST, R, R, T)            /* R[a] = R[b], приведенное к скалярному типу c */ \
+    X(GET_GLOBAL, R, G, _) \
+    X(SET_GLOBAL, R, G, _)      /* G = R[a] с приведением */ \
+    X(ADD, R, R, R)             /* R[a] = R[b] op R[c], порядок как OpKind ADD..SHR */ \
+    X(SUB, R, R, R) \
+    X(MUL, R, R, R) \
+    X(DIV, R, R, R) \
+    X(MOD, R, R, R) \
+    X(EQ, R, R, R) \
+    X(NEQ, R, R, R) \
+    X(LT, R, R, R) \
+    X(GT, R, R, R) \
+    X(LEQ, R, R, R) \
+    X(GEQ, R, R, R) \
+    X(AND, R, R, R)             /* в компиляторе не встречается: && и || - переходы */ \
+    X(OR, R, R, R) \
+    X(NOT, R, R, _)             /* R[a] = !R[b] */ \
+    X(BIT_AND, R, R, R) \
+    X(BIT_OR, R, R, R) \
+    X(BIT_XOR, R, R, R) \
+    X(BIT_NOT, R, R, _) \
+    X(SHL, R, R, R) \
+    X(SHR, R, R, R) \
+    X(NEG, R, R, _) \
+    X(PLUS, R, R, _) \
+    X(TEST, R, R, _)            /* R[a] = bool(R[b]) */ \
+    X(JMP, _, J, _)             /* переход от следующей инструкции */ \
+    X(JMP_IF, R, J, _) \
+    X(JMP_IFNOT, R, J, _) \
+    X(CALL, R, F, N)            /* аргументы R[a..a+c), результат в R[a] */ \
+    X(RET, R, _, _) \
+    X(RET_VOID, _, _, _) \
+    X(GET_FIELD, R, R, N)       /* R[a] = R[b].поле c */ \
+    X(SET_FIELD, R, N, R)       /* R[a].поле b = R[c] */ \
+    X(GET_INDEX, R, R, R)       /* R[a] = R[b][R[c]] */ \
+    X(SET_INDEX, R, R, R)       /* R[a][R[b]] = R[c] */ \
+    X(NEW_ARRAY, R, R, T)       /* R[a] = массив из R[b] значений по умолчанию типа c */ \
+    X(NEW_OBJECT, R, N, _)      /* R[a] = объект из b пустых ячеек */ \
+    X(MARK, R, _, _)            /* R[a] = отметка кучи */ \
+    X(RELEASE, R, _, _)         /* освободить созданное после отметки R[a] */ \
+    X(READ, R, _, _) \
+    X(PRINT, R, _, _)           /* R[a] и перевод строки */ \
+    X(NEWLINE, _, _, _) \
+    X(SIZEOF, R, R, _) \
+    X(EXIT, R, _, _) \
+    X(ASSERT, R, M, _) \
+    /* суперинструкции компилятора */ \
+    X(JMP_EQ, R, R, N)          /* R[a] op R[b] != c - выполнить следующий JMP, иначе пропустить */ \
+    X(JMP_NEQ, R, R, N) \
+    X(JMP_LT, R, R, N) \
+    X(JMP_GT, R, R, N) \
+    X(JMP_LEQ, R, R, N) \
+    X(JMP_GEQ, R, R, N) \
+    X(ADD_STORE, R, R, R)       /* R[a] = R[b] + R[c] с приведением к типу R[a] */ \
+    X(INC_LOCAL, R, I, _)       /* R[a] += b, b - int16 */ \
+    /* ускоренные формы, в них VM переписывает ADD..GEQ по типам операндов; */ \
+    /* при других типах инструкция возвращается к общей форме */ \
+    X(ADD_II, R, R, R) \
+    X(SUB_II, R, R, R) \
+    X(MUL_II, R, R, R) \
+    X(DIV_II, R, R, R) \
+    X(MOD_II, R, R, R) \
+    X(EQ_II, R, R, R) \
+    X(NEQ_II, R, R, R) \
+    X(LT_II, R, R, R) \
+    X(GT_II, R, R, R) \
+    X(LEQ_II, R, R, R) \
+    X(GEQ_II, R, R, R) \
+    X(ADD_FF, R, R, R) \
+    X(SUB_FF, R, R, R) \
+    X(MUL_FF, R, R, R) \
+    X(DIV_FF, R, R, R) \
+    X(EQ_FF, R, R, R) \
+    X(NEQ_FF, R, R, R) \
+    X(LT_FF, R, R, R) \
+    X(GT_FF, R, R, R) \
+    X(LEQ_FF, R, R, R) \
+    X(GEQ_FF, R, R, R)
+
+enum class Op : std::uint8_t {
+#define VM_ENUM(name, a, b, c) name,
+    VM_OPCODES(VM_ENUM)
+#undef VM_ENUM
+};
+
+using Reg = std::uint16_t;
+
+struct Instr {
+    Op op;
+    Reg a = 0;
+    Reg b = 0;
+    Reg c = 0;
+
+    std::uint32_t wide() const { return b | static_cast<std::uint32_t>(c) << 16; }
+    std::int32_t jump() const { return static_cast<std::int32_t>(wide()); }
+    void set_wide(std::uint32_t value) {
+        b = static_cast<Reg>(value);
+        c = static_cast<Reg>(value >> 16);
+    }
+};
+
+static_assert(sizeof(Instr) == 8);
+
+// NEW_ARRAY без значений по умолчанию: элементы-структуры создает код конструктора
+inline constexpr Reg NO_TYPE = 0xFFFF;
+
+struct Function {
+    std::string name;
+    std::vector<Instr> code;            // пусто - функция объявлена без тела
+    std::vector<Value> constants;       // при вызове копируются в R[constant_base..]
+    Reg params = 0;
+    Reg constant_base = 0;
+    Reg registers = 0;                  // размер кадра вместе с константами
+    TypeId result = types::VOID;        // UNKNOWN - без приведения, у точки входа
+    bool constructor = false;           // конструктор структуры: созданное в куче остается
+};
+
+struct Module {
+    std::vector<Function> functions;    // сначала по номерам Program::functions, затем конструкторы
+    std::vector<std::uint32_t> constructors;    // номер функции-конструктора по номеру структуры
+    std::vector<std::string_view> messages;     // сообщения ASSERT
+    std::uint32_t globals = 0;
+    std::uint32_t entry = 0;            // глобальные переменные, ассерты, вызов main
+};
+
+// байткод всей программы после Resolver. ошибки (нет main, кадр больше регистров) - std::runtime_error
+Module compile(const Program& program, ASTRootNode& root);
+
+// вид операнда по VM_OPCODES
+enum class Operand : std::uint8_t { _, R, N, I, T, F, G, J, M };
+
+struct OpInfo {
+    std::string_view name;
+    Operand a, b, c;
+};
+
+const OpInfo& opInfo(Op op);
+void disassemble(const Module& module, std::ostream& out);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ast.hpp"
+#include "resolver.hpp"
+#include "value.hpp"
+#include "visitor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <vector>
+
+// выполнение дерева после Resolver. переменные - ячейки одного стека значений: глобальные
+// в начале, дальше кадры функций, так что доступ к имени - индекс (depth ? base : 0) + slot.
+// стек не растет, ссылки на ячейки живут все выполнение. массивы и структуры - в heap,
+// блок и вызов при выходе освобождают созданное внутри них. выражение, под рекурсию по
+// которому не хватает NATIVE_STACK, досчитывается явным стеком; вызовы и операторы
+// рекурсивны до края стека вызовов, там - ошибка. ошибка - std::runtime_error
+class EvalVisitor : public ASTVisitor {
+public:
+    static constexpr std::size_t STACK_SLOTS = 1 << 20;
+    static constexpr std::size_t NATIVE_STACK = 1 << 20;      // байт стека вызовов под рекурсию eval
+    static constexpr std::size_t NATIVE_RESERVE = 256 << 10;  // байт у края стека вызовов на ошибку
+
+    EvalVisitor(const Program& program, std::istream& in, std::ostream& out);
+
+    // глобальные переменные и ассерты по порядку, затем main; код выхода - значение exit(...)
+    // или того, что вернула main
+    int run(ASTRootNode& root);
+
+    void visit(TernaryExprNode& node) override;
+    void visit(BinaryExprNode& node) override;
+    void visit(UnaryExprNode& node) override;
+    void visit(AssignExprNode& node) override;
+    void visit(PostfixExprNode& node) override;
+    void visit(LiteralExprNode& node) override;
+    void visit(IdExprNode& node) override;
+    void visit(MemberAccessExprNode& node) override;
+    void visit(CallExprNode& node) override;
+    void visit(ArrayAccessExprNode& node) override;
+    void visit(ArrayInitExprNode& node) override;
+
+    void visit(ReturnStatmNode& node) override;
+    void visit(BreakStatmNode& node) override;
+    void visit(ContinueStatmNode& node) override;
+    void visit(ConditionStatmNode& node) override;
+    void visit(ExprStatmNode& node) override;
+    void visit(BlockStatmNode& node) override;
+    void visit(ForStatmNode& node) override;
+    void visit(WhileStatmNode& node) override;
+    void visit(InputStatmNode& node) override;
+    void visit(OutStatmNode& node) override;
+    void visit(SZFStatmNode& node) override;
+    void visit(ExitStatmNode& node) override;
+
+    void visit(VarDeclNode& node) override;
+    void visit(FuncDeclNode& node) override;
+    void visit(StructDeclNode& node) override;
+    void visit(AssertDeclNode& node) override;
+
+    void visit(ASTRootNode& node) override;
+
+private:
+    enum class Flow : std::uint8_t { NEXT, BREAK, CONTINUE, RETURN };
+    struct Exit { int code; };
+
+    const Program& program;
+    std::istream& in;
+    std::ostream& out;
+    std::unique_ptr<Value[]> stack;
+    std::size_t base = 0;           // начало кадра текущей функции
+    std::size_t top = 0;            // первая свободная ячейка
+    std::uintptr_t limit = 0;       // адрес на стеке вызовов, ниже которого eval не рекурсивен
+    std::uintptr_t bottom = 0;      // ниже - "слишком глубокая рекурсия" у вызова и оператора
+    Heap heap;
+    Value value;                    // результат последнего выражения
+    Flow flow = Flow::NEXT;
+
+    Value eval(ExprNode& node);
+    Value eval_deep(ExprNode& root);
+    void exec(StatmNode* node);
+    Value& place(ExprNode& node);
+    Value& locate(ExprNode& node, const Value* operands);
+    Value& slot(std::uint16_t depth, std::uint32_t index) { return stack[(depth ? base : 0) + index]; }
+    Value result(StatmNode& node);
+    Value call(const FuncDeclNode& func, std::span<ExprNode* const> arguments);
+    void enter(const FuncDeclNode& func) const;
+    void bind(const FuncDeclNode& func, std::size_t frame, std::size_t i, const Value& argument);
+    Value invoke(const FuncDeclNode& func, std::size_t frame, std::size_t mark);
+
+    Value make(TypeId type);
+    void declare(Value& target, TypeId type, const VariableNode& var);
+};
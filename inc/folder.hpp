@@ -0,0 +1,73 @@
+#pragma once
+
+#include "arena.hpp"
+#include "ast.hpp"
+#include "resolver.hpp"
+#include "value.hpp"
+#include "visitor.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// свертка констант после Resolver, перед любым выполнением: операторы над литералами
+// заменяются литералом результата, имя const-переменной с литеральным начальным значением -
+// этим значением, приведенным к ее типу, if и тернарный оператор с известным условием -
+// нужной веткой, while и for с ложным условием убираются, do-while - заменяется телом.
+// считается той же семантикой values::, что и при выполнении; то, что бросило бы ошибку
+// (деление на ноль), остается как есть и упадет уже при выполнении, если до него дойдет.
+// новые узлы - в arena дерева
+class Folder {
+public:
+    Folder(const Program& program, AstArena& arena) : program(program), arena(arena) {}
+
+    // сколько узлов стало меньше в дереве
+    std::size_t fold(ASTRootNode& root);
+
+    void operator()(TernaryExprNode& node);
+    void operator()(BinaryExprNode& node);
+    void operator()(UnaryExprNode& node);
+    void operator()(AssignExprNode& node);
+    void operator()(PostfixExprNode& node);
+    void operator()(IdExprNode& node);
+    void operator()(MemberAccessExprNode& node);
+    void operator()(CallExprNode& node);
+    void operator()(ArrayAccessExprNode& node);
+    void operator()(ArrayInitExprNode& node);
+
+    void operator()(ReturnStatmNode& node);
+    void operator()(ConditionStatmNode& node);
+    void operator()(ExprStatmNode& node);
+    void operator()(BlockStatmNode& node);
+    void operator()(ForStatmNode& node);
+    void operator()(WhileStatmNode& node);
+    void operator()(InputStatmNode& node);
+    void operator()(OutStatmNode& node);
+    void operator()(SZFStatmNode& node);
+    void operator()(ExitStatmNode& node);
+
+    void operator()(VarDeclNode& node);
+    void operator()(FuncDeclNode& node);
+    void operator()(StructDeclNode& node);
+    void operator()(AssertDeclNode& node);
+
+    void operator()(ASTRootNode& node);
+
+private:
+    const Program& program;
+    AstArena& arena;
+    // известные значения const-переменных по ячейкам Resolver, NOTHING - не константа.
+    // ячейка закрытого блока переиспользуется, но следующее объявление в ней перезаписывает
+    // значение раньше, чем его кто-то прочитает
+    std::vector<Value> globals;
+    std::vector<Value> locals;
+    ExprNode* folded = nullptr;     // чем заменить выражение, nullptr - оставить как есть
+    StatmNode* kept = nullptr;      // чем заменить оператор, nullptr - убрать
+    bool conditional = false;       // оператор - ветка if или тело цикла без фигурных скобок
+    OperandStack<ExprNode*> operands;   // свернутые операнды
+
+    ExprNode* expression(ExprNode* node);
+    StatmNode* statement(StatmNode* node);
+    StatmNode* branch(StatmNode* node);
+    void replace(const Value& value);
+    static bool constant(const ExprNode* node, Value& value);
+};
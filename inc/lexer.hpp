@@ -1,24 +1,49 @@
 #pragma once
 
 #include "token.hpp"
+#include "source.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 class Lexer {
 public:
-    Lexer(const std::string&);
-    std::vector<Token> tokenize();
+    explicit Lexer(const SourceBuffer&);
+    Token next();                   // следующий токен, после конца - END_OF_FILE
+    std::vector<Token> tokenize();  // весь поток сразу, для инструментов
+
+    // то же, что tokenize(), но вход режется на куски по безопасным переводам строк
+    // и куски лексятся в нескольких потоках; 0 - по числу ядер
+    std::vector<Token> tokenize_parallel(std::size_t threads = 0);
+
+    const SourceBuffer& getSource() const noexcept { return source; }
+
+    // токены [first, old_end) старого потока заменены на [first, new_end) нового
+    struct TokenRange {
+        std::size_t first;
+        std::size_t old_end;
+        std::size_t new_end;
+    };
+
+    // пересборка потока после правки: tokens - результат tokenize() по old, после вызова - по updated
+    // (old с примененной edit). лексится только участок от границы токена перед правкой до места,
+    // где новый поток снова совпал со старым; остальные токены лишь переносятся в новый буфер
+    static TokenRange relex(const SourceBuffer& old, const SourceBuffer& updated,
+                            std::vector<Token>& tokens, const SourceEdit& edit);
 
 private:
-    std::string input;
+    Lexer(const SourceBuffer& source, std::string_view chunk) : source(source), input(chunk) {}
+
+    const SourceBuffer& source;
+    std::string_view input;     // весь буфер или кусок при параллельном лексинге
     std::size_t index = 0;
 
     Token extract();
     Token extract_id();
     Token extract_num();
     Token extract_char();
+    char extract_escape();
     Token extract_str();
     Token extract_op();
     void skip_comment();
@@ -27,8 +52,12 @@ private:
     void advance(std::size_t = 1) noexcept;
     [[noreturn]] void report(const std::string&) const;
 
-    static const std::unordered_map<std::string, TokenType> comm_sym;
-    static const std::unordered_map<std::string, TokenType> esc_chars;
-    static const std::unordered_map<std::string, TokenType> keywords;
-    static const std::unordered_map<std::string, TokenType> operators;
+    Token make_token(TokenType, std::size_t) noexcept;
+
+    static std::vector<std::size_t> split_points(std::string_view, std::size_t);
+
+    // таблица ключевых слов построена на switch по сырым символам:
+    // ни хэширования, ни аллокаций при распознавании
+    static constexpr TokenType keyword(std::string_view) noexcept;
+
 };
\ No newline at end of file
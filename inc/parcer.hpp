@@ -1,64 +1,157 @@
 #pragma once
 
 #include "token.hpp"
+#include "token_buffer.hpp"
+#include "token_stream.hpp"
+#include "lexer.hpp"
 #include "ast.hpp"
+#include "arena.hpp"
 
+#include <cstdint>
+#include <expected>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
-#include <memory>
+
+// ошибка разбора: где, что и какой токен ожидался
+struct Diagnostic {
+    std::size_t token;                          // номер токена в потоке
+    std::size_t offset;                         // смещение в исходнике
+    TokenType expected = TokenType::ERROR;      // ERROR - ожидался не один конкретный токен
+    std::string message;
+};
+
+enum class ParceMode {
+    STRICT,     // остановиться на первой ошибке и бросить std::runtime_error
+    RECOVER,    // собрать все ошибки за один проход, пропуская испорченные конструкции
+};
 
 class Parcer {
     public:
-        explicit Parcer(const std::vector<Token>& token_array);
-        void parce();
-        std::shared_ptr<ASTNode> getASTRoot() const;
+        // сила связывания операторов в выражении, по возрастанию
+        enum Power : std::uint8_t {
+            NONE,
+            COMMA,
+            ASSIGNMENT,         // правоассоциативно, как и ?:
+            TERNARY,
+            LOGIC_OR,
+            LOGIC_AND,
+            BIT_OR,
+            BIT_XOR,
+            BIT_AND,
+            EQUALITY,
+            COMPARISON,
+            SHIFT,
+            TERM,
+            FACTOR,
+            PREFIX,
+            POSTFIX,
+        };
+
+        // узлы дерева создаются в arena, она должна пережить дерево
+        Parcer(Lexer& lexer, AstArena& arena);                      // токены по требованию
+        Parcer(const TokenStream& stream, AstArena& arena);         // готовый поток токенов
+        void parce(ParceMode mode = ParceMode::STRICT);
+        // объявления верхнего уровня разбираются на threads потоках (0 - по числу ядер),
+        // у каждого потока своя дочерняя арена. дерево, номера символов и ошибки те же,
+        // что у parce(); работает только для Parcer(const TokenStream&, ...)
+        void parce_parallel(std::size_t threads = 0);
+        // тела функций только находятся по скобкам и разбираются при первом обращении
+        // через parce_body; работает только для Parcer(const TokenStream&, ...)
+        void set_lazy_bodies(bool lazy);
+        // разобрать отложенное тело; ошибки в нем видны только здесь (std::runtime_error).
+        // stream и arena - те же, что при разборе объявления; не потокобезопасно
+        static BlockStatmNode* parce_body(const TokenStream& stream, AstArena& arena, FuncDeclNode& func);
+        // разбор после правки: у этого Parcer поток нового текста, previous разбирал старый,
+        // change - результат Lexer::relex. объявления верхнего уровня, не задетые правкой,
+        // берутся из дерева previous как есть, заново разбираются только задетые.
+        // арена и SourceBuffer previous должны пережить новое дерево - оно делит с ним узлы,
+        // а строковые литералы в них смотрят в старый текст. работает только для TokenStream
+        void reparce(const Parcer& previous, const Lexer::TokenRange& change, ParceMode mode = ParceMode::STRICT);
+        ASTNode* getASTRoot() const;
+        const std::vector<Diagnostic>& getDiagnostics() const;
+        std::string describe(const Diagnostic& diagnostic) const;  // "файл:строка:столбец: сообщение"
 
     private:
-        const std::vector<Token>& token_array;
-        size_t index = 0;
-        std::shared_ptr<ASTRootNode> root;
+        // ошибка уже записана в diagnostics, наверх передается только признак -
+        // без раскрутки исключений на каждом неудачном разборе
+        struct Failed {};
+        template <typename T>
+        using Parced = std::expected<T, Failed>;
+        static constexpr std::unexpected<Failed> failed{Failed{}};
+
+        // незаконченный оператор в expression(): ждет свой правый операнд (или ')', ':').
+        // стек таких кадров вместо рекурсии за каждым операндом
+        struct Frame {
+            enum Kind : std::uint8_t { PREFIX, BINARY, ASSIGN, GROUP, TERNARY_TRUE, TERNARY_FALSE };
+            Kind kind;
+            Power outer;                // min_power, действовавшая до кадра
+            OpKind oper = OpKind::NONE;
+            ExprNode* left = nullptr;   // левый операнд или условие ?:
+            ExprNode* middle = nullptr; // ветка true у ?:
+        };
+
+        // кусок потока [first, last) для одного потока parce_parallel
+        Parcer(const TokenStream& stream, std::size_t first, std::size_t last, AstArena& arena,
+               std::unordered_map<std::string_view, Symbol> names);
+
+        const SourceBuffer& source;
+        const TokenStream* stream = nullptr;
+        TokenBuffer tokens;
+        AstArena& arena;
+        ASTRootNode* root = nullptr;
+        std::unordered_map<std::string_view, Symbol> names;        // вид в source -> символ
+        ParceMode mode = ParceMode::STRICT;
+        bool lazy_bodies = false;
+        std::vector<Diagnostic> diagnostics;
+        std::vector<Frame> frames;                                  // общий для вложенных expression()
+
+        // токены [first, last) каждого объявления из root->statements - для reparce
+        struct DeclRange {
+            std::uint32_t first;
+            std::uint32_t last;
+        };
+        std::vector<DeclRange> ranges;
 
-        bool check(TokenType type) const;
+        bool check(TokenType type);
         bool check_advance(TokenType type);
         void advance();
-        Token peek() const;
+        const Token& peek(std::size_t offset = 0);
+        const Token& previous() const;
+        Symbol symbol();                                            // текущий токен как имя, со сдвигом
+        Symbol intern(std::string_view text);
+        std::unexpected<Failed> report(const std::string& message, TokenType expected = TokenType::ERROR);
+        void synchronize(std::size_t start, bool nested);
+        bool skip_block();
 
         void parcer_starter();
-        std::shared_ptr<DeclNode> declaration();
-        std::shared_ptr<DeclNode> variable_declaration();
-        std::shared_ptr<FuncDeclNode> function_declaration();
-        std::shared_ptr<DeclNode> struct_declaration();
-        std::shared_ptr<DeclNode> assert_declaration();
+        void declarations(std::pmr::vector<ASTNode*>& statements);
+        bool next_declaration(std::pmr::vector<ASTNode*>& statements);  // false - стоп в STRICT
+        std::vector<std::size_t> declaration_starts();
+        Parced<DeclNode*> declaration();
+        Parced<DeclNode*> variable_declaration();
+        Parced<FuncDeclNode*> function_declaration();
+        Parced<DeclNode*> struct_declaration();
+        Parced<DeclNode*> assert_declaration();
 
-        std::shared_ptr<StatmNode> statement();
-        std::shared_ptr<StatmNode> expression_statement();
-        std::shared_ptr<StatmNode> return_statement();
-        std::shared_ptr<StatmNode> break_statement();
-        std::shared_ptr<StatmNode> continue_statement();
-        std::shared_ptr<StatmNode> conditional_statement();
-        std::shared_ptr<StatmNode> block_statement();
-        std::shared_ptr<StatmNode> for_statement();
-        std::shared_ptr<StatmNode> dowhile_statement();
-        std::shared_ptr<StatmNode> while_statement();
-        std::shared_ptr<StatmNode> in_statement();
-        std::shared_ptr<StatmNode> out_statement();
-        std::shared_ptr<StatmNode> sizeof_statement();
-        std::shared_ptr<StatmNode> exit_statement();
+        Parced<StatmNode*> statement();
+        Parced<StatmNode*> expression_statement();
+        Parced<StatmNode*> return_statement();
+        Parced<StatmNode*> break_statement();
+        Parced<StatmNode*> continue_statement();
+        Parced<StatmNode*> conditional_statement();
+        Parced<StatmNode*> block_statement();
+        Parced<StatmNode*> for_statement();
+        Parced<StatmNode*> dowhile_statement();
+        Parced<StatmNode*> while_statement();
+        Parced<StatmNode*> in_statement();
+        Parced<StatmNode*> out_statement();
+        Parced<StatmNode*> sizeof_statement();
+        Parced<StatmNode*> exit_statement();
 
-        std::shared_ptr<ExprNode> expression();
-        std::shared_ptr<ExprNode> ternary_expression();
-        std::shared_ptr<ExprNode> or_expression();
-        std::shared_ptr<ExprNode> and_expression();
-        std::shared_ptr<ExprNode> equality_expression();
-        std::shared_ptr<ExprNode> comparison_expression();
-        std::shared_ptr<ExprNode> term_expression();
-        std::shared_ptr<ExprNode> factor_expression();
-        std::shared_ptr<ExprNode> unary_expression();
-        std::shared_ptr<ExprNode> assign_expression();
-        std::shared_ptr<ExprNode> postfix_expression();
-        std::shared_ptr<ExprNode> literal_expression();
-        std::shared_ptr<ExprNode> id_expression();
-        std::shared_ptr<ExprNode> member_access_expression();
-        std::shared_ptr<ExprNode> array_access_expression();
-        std::shared_ptr<ExprNode> array_initialization_expression();
+        Parced<ExprNode*> expression(Power min_power = NONE);     // без запятой - expression(COMMA)
+        Parced<ExprNode*> postfix_expression(TokenType type, ExprNode* expr);
+        Parced<ExprNode*> literal_expression();
+        Parced<ExprNode*> array_initialization_expression();
 };
\ No newline at end of file
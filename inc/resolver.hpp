@@ -0,0 +1,139 @@
+#pragma once
+
+#include "arena.hpp"
+#include "ast.hpp"
+#include "symbol.hpp"
+#include "token_stream.hpp"
+#include "visitor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// тип во время выполнения: встроенный или структура types::STRUCT + номер в Program::structs
+using TypeId = std::uint32_t;
+
+namespace types {
+inline constexpr TypeId INT = 0, FLOAT = 1, CHAR = 2, BOOL = 3, VOID = 4, STRUCT = 5;
+inline constexpr TypeId UNKNOWN = ~TypeId(0);
+}
+
+struct StructLayout {
+    StructDeclNode* decl;
+    std::vector<VariableNode*> fields;  // по номеру поля, подряд из всех объявлений в структуре
+    std::vector<TypeId> field_types;
+};
+
+// все, что нужно для выполнения после Resolver: переменные уже пронумерованы в самих узлах
+struct Program {
+    std::vector<FuncDeclNode*> functions;   // по CallExprNode::function
+    std::vector<StructLayout> structs;
+    std::vector<TypeId> types;              // по Symbol имени типа, UNKNOWN - не тип
+    std::uint32_t globals = 0;              // ячеек под глобальные переменные
+    std::uint32_t main = UNRESOLVED;        // номер main в functions
+
+    TypeId type(Symbol name) const { return name < types.size() ? types[name] : types::UNKNOWN; }
+};
+
+// разрешение имен перед выполнением: каждому IdExprNode и VariableNode - пара (глубина области,
+// ячейка), глобальные нумеруются отдельно, локальные - в одном кадре функции, и ячейки
+// закрытых блоков переиспользуются. полям и вызовам - номера, функциям - размер кадра,
+// так что во время выполнения имена больше не ищутся. порядок как в си: переменная видна
+// после объявления, функции - везде. const-переменную, ее элементы и поля менять нельзя.
+// ошибка - std::runtime_error
+class Resolver {
+public:
+    Program resolve(ASTRootNode& root);
+    // отложенные тела (Parcer::set_lazy_bodies) разбираются через Parcer::parce_body, когда до
+    // функции доходит вызов из main, глобальных инициализаторов или уже разобранной функции;
+    // тело, до которого вызовы не доходят, не разбирается и не проверяется вовсе.
+    // stream и arena - те же, что у Parcer
+    void set_lazy_bodies(const TokenStream& stream, AstArena& arena);
+
+    void operator()(TernaryExprNode& node);
+    void operator()(BinaryExprNode& node);
+    void operator()(UnaryExprNode& node);
+    void operator()(AssignExprNode& node);
+    void operator()(PostfixExprNode& node);
+    void operator()(LiteralExprNode& node);
+    void operator()(IdExprNode& node);
+    void operator()(MemberAccessExprNode& node);
+    void operator()(CallExprNode& node);
+    void operator()(ArrayAccessExprNode& node);
+    void operator()(ArrayInitExprNode& node);
+
+    void operator()(ReturnStatmNode& node);
+    void operator()(BreakStatmNode& node);
+    void operator()(ContinueStatmNode& node);
+    void operator()(ConditionStatmNode& node);
+    void operator()(ExprStatmNode& node);
+    void operator()(BlockStatmNode& node);
+    void operator()(ForStatmNode& node);
+    void operator()(WhileStatmNode& node);
+    void operator()(InputStatmNode& node);
+    void operator()(OutStatmNode& node);
+    void operator()(SZFStatmNode& node);
+    void operator()(ExitStatmNode& node);
+
+    void operator()(VarDeclNode& node);
+    void operator()(FuncDeclNode& node);
+    void operator()(StructDeclNode& node);
+    void operator()(AssertDeclNode& node);
+
+    void operator()(ASTRootNode& node);
+
+private:
+    struct Local {
+        Symbol name;
+        std::uint16_t depth;
+        std::uint32_t slot;
+        TypeId type;
+        bool array;
+        bool constant;
+        std::uint32_t shadowed;     // прежнее innermost[name]
+    };
+    struct Scope {
+        std::size_t first;          // первое имя области в locals
+        std::uint32_t next_slot;    // свободная ячейка кадра при открытии
+    };
+    struct Typed {
+        TypeId type;
+        bool array;
+    };
+    // что было видно в объявлении функции с отложенным телом: разбирается она уже после
+    // всего файла, и объявленное ниже нее прячется на это время
+    struct Lazy {
+        std::size_t globals = 0;    // глобальных имен в locals
+        std::size_t structs = 0;
+        bool reached = false;
+    };
+
+    Program program;
+    std::unordered_map<Symbol, std::uint32_t> functions;
+    std::vector<Local> locals;      // видимые имена, внутренние области в конце
+    std::vector<std::uint32_t> innermost;   // по Symbol - последний Local с таким именем
+    std::vector<Scope> scopes;      // scopes[0] - глобальная
+    std::uint32_t next_slot = 0;
+    std::uint32_t frame_size = 0;
+    std::size_t loops = 0;          // вложенность циклов, для break и continue
+    TypeId type = types::UNKNOWN;   // тип последнего выражения - для доступа к полям,
+    bool array = false;             // у массива - тип элемента
+    OperandStack<Typed> operands;   // типы разобранных операндов
+    const TokenStream* stream = nullptr;
+    AstArena* arena = nullptr;
+    std::vector<Lazy> lazy;         // по номеру функции
+    std::vector<std::uint32_t> reached;     // вызванные отложенные функции, ждут разбора
+
+    TypeId expression(ExprNode* node);
+    void statement(ASTNode* node);
+    void open_scope();
+    void close_scope();
+    const Local& declare(Symbol name, TypeId type, bool array, bool constant = false);
+    static bool is_array(const VariableNode& var);
+    void check_target(ExprNode* node) const;
+    TypeId type_of(Symbol name) const;
+    void add_struct(StructDeclNode& node);
+    void reach(std::uint32_t function);
+    void define(std::uint32_t function);
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// классы символов для лексера: таблица вместо локале-зависимых std::isspace/isalpha,
+// а длинные серии одного класса пропускаются по 16 (SSE2) или 32 (AVX2) байта за шаг
+namespace scan {
+
+enum CharClass : std::uint8_t {
+    SPACE = 1 << 0,
+    ALPHA = 1 << 1,     // буква или '_', начало идентификатора
+    DIGIT = 1 << 2,
+    IDENT = ALPHA | DIGIT,
+};
+
+inline constexpr std::array<std::uint8_t, 256> table = [] {
+    std::array<std::uint8_t, 256> t{};
+    for (int c = '\t'; c <= '\r'; ++c) t[c] = SPACE;
+    t[' '] = SPACE;
+    for (int c = 'a'; c <= 'z'; ++c) t[c] = ALPHA;
+    for (int c = 'A'; c <= 'Z'; ++c) t[c] = ALPHA;
+    t['_'] = ALPHA;
+    for (int c = '0'; c <= '9'; ++c) t[c] = DIGIT;
+    return t;
+}();
+
+inline constexpr bool is(char c, std::uint8_t cls) noexcept {
+    return table[static_cast<unsigned char>(c)] & cls;
+}
+
+// каждая функция возвращает индекс первого символа не из серии (или input.size())
+std::size_t skip_space(std::string_view input, std::size_t index) noexcept;
+std::size_t skip_ident(std::string_view input, std::size_t index) noexcept;
+std::size_t skip_digits(std::string_view input, std::size_t index) noexcept;
+std::size_t find_quote(std::string_view input, std::size_t index) noexcept;
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SourceLocation {
+    std::uint32_t line;     // с 1
+    std::uint32_t column;   // с 1, в байтах
+};
+
+// правка текста: removed байт начиная с offset заменяются на inserted
+struct SourceEdit {
+    std::size_t offset;
+    std::size_t removed;
+    std::string_view inserted;
+};
+
+// владеет текстом программы, токены и AST хранят только string_view в него,
+// поэтому буфер должен жить дольше лексера, парсера и дерева
+class SourceBuffer {
+public:
+    explicit SourceBuffer(std::string text) : text(std::move(text)), data(this->text) {}
+    ~SourceBuffer();
+
+    // обычный файл отображается в память только для чтения, текст не копируется;
+    // канал, FIFO и устройство читаются в собственную строку
+    static std::unique_ptr<SourceBuffer> map_file(const std::string& path);
+
+    // новый буфер с примененной правкой, сам буфер не меняется
+    std::unique_ptr<SourceBuffer> edited(const SourceEdit& edit) const;
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    std::string_view view() const noexcept { return data; }
+    std::size_t size() const noexcept { return data.size(); }
+    const std::string& path() const noexcept { return file; }
+
+    // строка и столбец считаются только для диагностик: индекс начал строк
+    // строится при первом обращении, токены хранят лишь смещение
+    SourceLocation location(std::size_t offset) const;
+    std::string where(std::size_t offset) const;   // "файл:строка:столбец"
+    std::size_t offset_of(std::string_view part) const noexcept { return part.data() - data.data(); }
+
+private:
+    SourceBuffer(std::string file, const char* mapping, std::size_t size) :
+        file(std::move(file)), data(mapping, size), mapped(size != 0) {}
+
+    std::string text;
+    std::string file;
+    std::string_view data;
+    bool mapped = false;
+
+    mutable std::once_flag lines_once;
+    mutable std::vector<std::uint32_t> line_starts;
+};
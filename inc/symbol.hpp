@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// глобальная таблица имён: идентификаторы, имена типов и полей хранятся в AST
+// как 32-битные номера, одинаковый текст всегда получает один и тот же номер.
+// текст копируется в таблицу, так что имя переживает SourceBuffer.
+// функции потокобезопасны - таблица общая для всех разборов
+using Symbol = std::uint32_t;
+
+namespace symbols {
+
+Symbol intern(std::string_view text);
+std::string_view name(Symbol symbol);
+std::size_t size();
+
+}
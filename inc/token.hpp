@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <variant>
 
 enum class TokenType {
 
@@ -47,6 +50,7 @@ inline std::string tokenTypeToString(TokenType type) {
         case TokenType::FLOAT_LIT: return "FLOAT_LIT";
         case TokenType::CHAR_LIT: return "CHAR_LIT";
         case TokenType::STR_LIT: return "STR_LIT";
+        case TokenType::BOOL_LIT: return "BOOL_LIT";
         case TokenType::KW_STRUCT: return "KW_STRUCT";
         case TokenType::KW_INT: return "KW_INT";
         case TokenType::KW_FLOAT: return "KW_FLOAT";
@@ -61,6 +65,9 @@ inline std::string tokenTypeToString(TokenType type) {
         case TokenType::KW_RETURN: return "KW_RETURN";
         case TokenType::KW_BREAK: return "KW_BREAK";
         case TokenType::KW_CONTINUE: return "KW_CONTINUE";
+        case TokenType::KW_ASSERT: return "KW_ASSERT";
+        case TokenType::KW_CONST: return "KW_CONST";
+        case TokenType::KW_EXIT: return "KW_EXIT";
         case TokenType::KW_PRINT: return "KW_PRINT";
         case TokenType::KW_READ: return "KW_READ";
         case TokenType::KW_SIZEOF: return "KW_SIZEOF";
@@ -68,11 +75,13 @@ inline std::string tokenTypeToString(TokenType type) {
         case TokenType::MINUS: return "MINUS";
         case TokenType::SLASH: return "SLASH";
         case TokenType::STAR: return "STAR";
+        case TokenType::PERCENT: return "PERCENT";
         case TokenType::ASSIGN: return "ASSIGN";
         case TokenType::PLUS_ASSIGN: return "PLUS_ASSIGN";
         case TokenType::MINUS_ASSIGN: return "MINUS_ASSIGN";
         case TokenType::STAR_ASSIGN: return "STAR_ASSIGN";
         case TokenType::SLASH_ASSIGN: return "SLASH_ASSIGN";
+        case TokenType::PERCENT_ASSIGN: return "PERCENT_ASSIGN";
         case TokenType::EQ: return "EQ";
         case TokenType::NEQ: return "NEQ";
         case TokenType::LT: return "LT";
@@ -90,6 +99,7 @@ inline std::string tokenTypeToString(TokenType type) {
         case TokenType::BIT_SHR: return "BIT_SHR";
         case TokenType::INCREMENT: return "INCREMENT";
         case TokenType::DECREMENT: return "DECREMENT";
+        case TokenType::QMARK: return "QMARK";
         case TokenType::COLON: return "COLON";
         case TokenType::COMMA: return "COMMA";
         case TokenType::SEMICOLON: return "SEMICOLON";
@@ -106,9 +116,169 @@ inline std::string tokenTypeToString(TokenType type) {
     }
 }
 
+// написание токенов с фиксированным текстом; для идентификаторов, литералов
+// и конца файла - пустая строка, их текст нужно брать из исходника
+inline constexpr std::string_view tokenSpelling(TokenType type) {
+    switch (type) {
+        case TokenType::KW_INT: return "int";
+        case TokenType::KW_FLOAT: return "float";
+        case TokenType::KW_CHAR: return "char";
+        case TokenType::KW_BOOL: return "bool";
+        case TokenType::KW_VOID: return "void";
+        case TokenType::KW_STRUCT: return "struct";
+        case TokenType::KW_IF: return "if";
+        case TokenType::KW_ELSE: return "else";
+        case TokenType::KW_WHILE: return "while";
+        case TokenType::KW_DO: return "do";
+        case TokenType::KW_FOR: return "for";
+        case TokenType::KW_RETURN: return "return";
+        case TokenType::KW_BREAK: return "break";
+        case TokenType::KW_CONTINUE: return "continue";
+        case TokenType::KW_ASSERT: return "assert";
+        case TokenType::KW_CONST: return "const";
+        case TokenType::KW_EXIT: return "exit";
+        case TokenType::KW_PRINT: return "print";
+        case TokenType::KW_READ: return "read";
+        case TokenType::KW_SIZEOF: return "sizeof";
+        case TokenType::PLUS: return "+";
+        case TokenType::MINUS: return "-";
+        case TokenType::SLASH: return "/";
+        case TokenType::STAR: return "*";
+        case TokenType::PERCENT: return "%";
+        case TokenType::ASSIGN: return "=";
+        case TokenType::PLUS_ASSIGN: return "+=";
+        case TokenType::MINUS_ASSIGN: return "-=";
+        case TokenType::STAR_ASSIGN: return "*=";
+        case TokenType::SLASH_ASSIGN: return "/=";
+        case TokenType::PERCENT_ASSIGN: return "%=";
+        case TokenType::EQ: return "==";
+        case TokenType::NEQ: return "!=";
+        case TokenType::LT: return "<";
+        case TokenType::GT: return ">";
+        case TokenType::LEQ: return "<=";
+        case TokenType::GEQ: return ">=";
+        case TokenType::AND: return "&&";
+        case TokenType::OR: return "||";
+        case TokenType::NOT: return "!";
+        case TokenType::BIT_AND: return "&";
+        case TokenType::BIT_OR: return "|";
+        case TokenType::BIT_XOR: return "^";
+        case TokenType::BIT_NOT: return "~";
+        case TokenType::BIT_SHL: return "<<";
+        case TokenType::BIT_SHR: return ">>";
+        case TokenType::INCREMENT: return "++";
+        case TokenType::DECREMENT: return "--";
+        case TokenType::QMARK: return "?";
+        case TokenType::COLON: return ":";
+        case TokenType::COMMA: return ",";
+        case TokenType::SEMICOLON: return ";";
+        case TokenType::DOT: return ".";
+        case TokenType::ARROW: return "->";
+        case TokenType::LPAREN: return "(";
+        case TokenType::RPAREN: return ")";
+        case TokenType::LBRACE: return "{";
+        case TokenType::RBRACE: return "}";
+        case TokenType::LBRACKET: return "[";
+        case TokenType::RBRACKET: return "]";
+        default: return "";
+    }
+}
+
+// операторы в AST: плотная нумерация с нуля, чтобы по ним можно было
+// делать switch и таблицы. унарный минус - SUB в UnaryExprNode, префиксный ++ - INC
+enum class OpKind : std::uint8_t {
+    ADD, SUB, MUL, DIV, MOD,
+    EQ, NEQ, LT, GT, LEQ, GEQ,
+    AND, OR, NOT,
+    BIT_AND, BIT_OR, BIT_XOR, BIT_NOT, SHL, SHR,
+    INC, DEC,
+    ASSIGN, ADD_ASSIGN, SUB_ASSIGN, MUL_ASSIGN, DIV_ASSIGN, MOD_ASSIGN,
+    COMMA,
+    NONE,           // токен не оператор; заодно число операторов
+};
+
+inline constexpr OpKind opKind(TokenType type) {
+    switch (type) {
+        case TokenType::PLUS: return OpKind::ADD;
+        case TokenType::MINUS: return OpKind::SUB;
+        case TokenType::STAR: return OpKind::MUL;
+        case TokenType::SLASH: return OpKind::DIV;
+        case TokenType::PERCENT: return OpKind::MOD;
+        case TokenType::EQ: return OpKind::EQ;
+        case TokenType::NEQ: return OpKind::NEQ;
+        case TokenType::LT: return OpKind::LT;
+        case TokenType::GT: return OpKind::GT;
+        case TokenType::LEQ: return OpKind::LEQ;
+        case TokenType::GEQ: return OpKind::GEQ;
+        case TokenType::AND: return OpKind::AND;
+        case TokenType::OR: return OpKind::OR;
+        case TokenType::NOT: return OpKind::NOT;
+        case TokenType::BIT_AND: return OpKind::BIT_AND;
+        case TokenType::BIT_OR: return OpKind::BIT_OR;
+        case TokenType::BIT_XOR: return OpKind::BIT_XOR;
+        case TokenType::BIT_NOT: return OpKind::BIT_NOT;
+        case TokenType::BIT_SHL: return OpKind::SHL;
+        case TokenType::BIT_SHR: return OpKind::SHR;
+        case TokenType::INCREMENT: return OpKind::INC;
+        case TokenType::DECREMENT: return OpKind::DEC;
+        case TokenType::ASSIGN: return OpKind::ASSIGN;
+        case TokenType::PLUS_ASSIGN: return OpKind::ADD_ASSIGN;
+        case TokenType::MINUS_ASSIGN: return OpKind::SUB_ASSIGN;
+        case TokenType::STAR_ASSIGN: return OpKind::MUL_ASSIGN;
+        case TokenType::SLASH_ASSIGN: return OpKind::DIV_ASSIGN;
+        case TokenType::PERCENT_ASSIGN: return OpKind::MOD_ASSIGN;
+        case TokenType::COMMA: return OpKind::COMMA;
+        default: return OpKind::NONE;
+    }
+}
+
+inline constexpr TokenType opToken(OpKind op) {
+    switch (op) {
+        case OpKind::ADD: return TokenType::PLUS;
+        case OpKind::SUB: return TokenType::MINUS;
+        case OpKind::MUL: return TokenType::STAR;
+        case OpKind::DIV: return TokenType::SLASH;
+        case OpKind::MOD: return TokenType::PERCENT;
+        case OpKind::EQ: return TokenType::EQ;
+        case OpKind::NEQ: return TokenType::NEQ;
+        case OpKind::LT: return TokenType::LT;
+        case OpKind::GT: return TokenType::GT;
+        case OpKind::LEQ: return TokenType::LEQ;
+        case OpKind::GEQ: return TokenType::GEQ;
+        case OpKind::AND: return TokenType::AND;
+        case OpKind::OR: return TokenType::OR;
+        case OpKind::NOT: return TokenType::NOT;
+        case OpKind::BIT_AND: return TokenType::BIT_AND;
+        case OpKind::BIT_OR: return TokenType::BIT_OR;
+        case OpKind::BIT_XOR: return TokenType::BIT_XOR;
+        case OpKind::BIT_NOT: return TokenType::BIT_NOT;
+        case OpKind::SHL: return TokenType::BIT_SHL;
+        case OpKind::SHR: return TokenType::BIT_SHR;
+        case OpKind::INC: return TokenType::INCREMENT;
+        case OpKind::DEC: return TokenType::DECREMENT;
+        case OpKind::ASSIGN: return TokenType::ASSIGN;
+        case OpKind::ADD_ASSIGN: return TokenType::PLUS_ASSIGN;
+        case OpKind::SUB_ASSIGN: return TokenType::MINUS_ASSIGN;
+        case OpKind::MUL_ASSIGN: return TokenType::STAR_ASSIGN;
+        case OpKind::DIV_ASSIGN: return TokenType::SLASH_ASSIGN;
+        case OpKind::MOD_ASSIGN: return TokenType::PERCENT_ASSIGN;
+        case OpKind::COMMA: return TokenType::COMMA;
+        default: return TokenType::ERROR;
+    }
+}
+
+inline constexpr std::string_view opSpelling(OpKind op) {
+    return tokenSpelling(opToken(op));
+}
+
+// значение литерала, разобранное лексером один раз: INT_LIT - int, FLOAT_LIT - double,
+// CHAR_LIT - char, BOOL_LIT - bool; у остальных токенов пусто
+using LiteralValue = std::variant<std::monostate, int, double, char, bool>;
+
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value; // вид в SourceBuffer, сам текст не копируется
+    LiteralValue literal{};
 
     bool operator==(TokenType type) const {
         return this->type == type;
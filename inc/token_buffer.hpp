@@ -0,0 +1,63 @@
+#pragma once
+
+#include "token.hpp"
+#include "lexer.hpp"
+#include "token_stream.hpp"
+
+#include <array>
+
+// окно токенов для парсера: предыдущий, текущий и два следующих.
+// токены тянутся из лексера по требованию, поэтому память не растет с размером входа;
+// готовый TokenStream (для инструментов) подключается так же
+class TokenBuffer {
+public:
+    static constexpr std::size_t LOOKAHEAD = 2;
+
+    explicit TokenBuffer(Lexer& lexer) : lexer(&lexer) {}
+    explicit TokenBuffer(const TokenStream& stream) : stream(&stream), last(stream.size() - 1) {}
+
+    // часть потока [first, last): на last парсер видит END_OF_FILE, номера токенов - сквозные
+    TokenBuffer(const TokenStream& stream, std::size_t first, std::size_t last) :
+        stream(&stream), head(first), filled(first), last(last) {}
+
+    const Token& peek(std::size_t offset = 0) {
+        while (filled <= head + offset) {
+            ring[filled % CAPACITY] = pull();
+            ++filled;
+        }
+        return ring[(head + offset) % CAPACITY];
+    }
+
+    const Token& previous() const {
+        return ring[(head + CAPACITY - 1) % CAPACITY];
+    }
+
+    void advance() {
+        if (peek().type != TokenType::END_OF_FILE) ++head;
+    }
+
+    // номер текущего токена в потоке
+    std::size_t position() const noexcept { return head; }
+
+    // перейти к токену index, не читая промежуточные; только для TokenStream
+    void seek(std::size_t index) noexcept {
+        head = filled = index;
+    }
+
+private:
+    static constexpr std::size_t CAPACITY = LOOKAHEAD + 2;
+
+    Lexer* lexer = nullptr;
+    const TokenStream* stream = nullptr;
+    std::array<Token, CAPACITY> ring{};
+    std::size_t head = 0;
+    std::size_t filled = 0;
+    std::size_t last = 0;       // номер END_OF_FILE для потока
+
+    Token pull() {
+        if (lexer) return lexer->next();
+        if (filled < last) return (*stream)[filled];
+        Token end = (*stream)[last];
+        return {TokenType::END_OF_FILE, end.value.substr(0, 0)};
+    }
+};
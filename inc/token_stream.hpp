@@ -0,0 +1,49 @@
+#pragma once
+
+#include "token.hpp"
+#include "source.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// весь поток токенов в виде структуры массивов: байт вида и 32-битное смещение на токен.
+// длина текста нужна только идентификаторам и литералам, она лежит в отдельной таблице,
+// а у ключевых слов и операторов берется из tokenSpelling(). разобранные значения
+// литералов хранятся в третьей таблице, на которую ссылается запись длины
+class TokenStream {
+public:
+    explicit TokenStream(const SourceBuffer& source);                               // лексит весь буфер
+    TokenStream(const SourceBuffer& source, const std::vector<Token>& tokens);      // сжимает готовый массив
+
+    std::size_t size() const noexcept { return kinds.size(); }
+    TokenType type(std::size_t index) const noexcept { return static_cast<TokenType>(kinds[index]); }
+    std::uint32_t offset(std::size_t index) const noexcept { return offsets[index]; }
+    Token operator[](std::size_t index) const;
+
+    SourceLocation location(std::size_t index) const { return source.location(offsets[index]); }
+    const SourceBuffer& getSource() const noexcept { return source; }
+
+    std::size_t memory() const noexcept;    // байт под токены
+
+private:
+    static constexpr std::uint32_t NO_LITERAL = ~std::uint32_t(0);
+
+    struct Payload {
+        std::uint32_t length;
+        std::uint32_t literal;      // номер в literals или NO_LITERAL у идентификаторов
+    };
+
+    const SourceBuffer& source;
+    std::vector<std::uint8_t> kinds;
+    std::vector<std::uint32_t> offsets;
+
+    // бит на токен: есть ли у него запись в payloads. по блокам из 64 токенов
+    // хранится число записей до начала блока, номер записи - rank + popcount
+    std::vector<std::uint64_t> payload_mask;
+    std::vector<std::uint32_t> payload_rank;
+    std::vector<Payload> payloads;
+    std::vector<LiteralValue> literals;
+
+    void push(const Token& token);
+    void check_size() const;
+};
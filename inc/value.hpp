@@ -0,0 +1,118 @@
+#pragma once
+
+#include "token.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+struct Object;
+
+// номера видов Value, для switch по index()
+namespace values {
+enum Index : std::size_t { NOTHING, INT, DOUBLE, BOOL, CHAR, STRING, OBJECT };
+}
+
+// значение во время выполнения, 8 байт. массивы и структуры лежат в куче интерпретатора, в значении -
+// только указатель, а присваивание и передача в функцию копируют содержимое, как в си.
+// строка - указатель на string_view в узле литерала (текст в SourceBuffer), так что живет, пока
+// живет дерево: строки бывают только литеральные. NOTHING - результат void функции.
+// double хранится как есть, остальное - в отрицательных тихих NaN: 0xFFF8 | вид в битах 48..50 |
+// 48 бит данных. настоящий NaN приводится к 0x7FF8..., с упакованными значениями он не пересекается
+class Value {
+public:
+    Value() : bits(box(values::NOTHING, 0)) {}
+    Value(int x) : bits(box(values::INT, static_cast<std::uint32_t>(x))) {}
+    Value(double x) : bits(x != x ? QUIET_NAN : std::bit_cast<std::uint64_t>(x)) {}
+    Value(bool x) : bits(box(values::BOOL, x)) {}
+    Value(char x) : bits(box(values::CHAR, static_cast<unsigned char>(x))) {}
+    Value(const std::string_view* text) : bits(box(values::STRING, reinterpret_cast<std::uintptr_t>(text))) {}
+    Value(Object* object) : bits(box(values::OBJECT, reinterpret_cast<std::uintptr_t>(object))) {}
+
+    values::Index index() const {
+        return bits < BOXED ? values::DOUBLE : static_cast<values::Index>(bits >> 48 & 7);
+    }
+    bool is_int() const { return bits >> 48 == box(values::INT, 0) >> 48; }
+    bool is_double() const { return bits < BOXED; }
+    bool is_bool() const { return bits >> 48 == box(values::BOOL, 0) >> 48; }
+    bool is_object() const { return bits >> 48 == box(values::OBJECT, 0) >> 48; }
+
+    // без проверки вида
+    int as_int() const { return static_cast<std::int32_t>(static_cast<std::uint32_t>(bits)); }
+    double as_double() const { return std::bit_cast<double>(bits); }
+    bool as_bool() const { return bits & 1; }
+    char as_char() const { return static_cast<char>(bits & 0xFF); }
+    std::string_view as_string() const { return *reinterpret_cast<const std::string_view*>(bits & PAYLOAD); }
+    Object* as_object() const { return reinterpret_cast<Object*>(bits & PAYLOAD); }
+
+    // побитово: 0.0 и -0.0 различаются, NaN равен себе - для таблицы констант компилятора
+    bool operator==(const Value& other) const = default;
+    std::uint64_t raw() const { return bits; }
+
+private:
+    static constexpr std::uint64_t BOXED = 0xFFF8'0000'0000'0000;
+    static constexpr std::uint64_t PAYLOAD = 0x0000'FFFF'FFFF'FFFF;
+    static constexpr std::uint64_t QUIET_NAN = 0x7FF8'0000'0000'0000;
+
+    static constexpr std::uint64_t box(values::Index index, std::uint64_t payload) {
+        return BOXED | static_cast<std::uint64_t>(index) << 48 | payload;
+    }
+
+    std::uint64_t bits;
+};
+
+static_assert(sizeof(Value) == 8);
+
+template<>
+struct std::hash<Value> {
+    std::size_t operator()(const Value& value) const { return std::hash<std::uint64_t>{}(value.raw()); }
+};
+
+struct Object {
+    std::vector<Value> slots;   // элементы массива или поля структуры в порядке объявления
+};
+
+// объекты одного выполнения. освобождаются пачкой: все созданное после отметки - при выходе
+// из блока, итерации или вызова, так что ссылки на объект живут до конца его области
+class Heap {
+public:
+    Object* allocate(std::size_t size);
+    Object* clone(const Object& object);            // глубокая копия, вложенные объекты тоже
+    std::size_t mark() const { return objects.size(); }
+    void release(std::size_t mark);
+    void release(std::size_t first, std::size_t last);  // созданное после last остается
+
+private:
+    std::vector<std::unique_ptr<Object>> objects;
+};
+
+// общая семантика значений для EvalVisitor и VM. ошибки - std::runtime_error
+namespace values {
+
+// значение литерала дерева; строка ссылается на вид внутри literal
+Value literal(const std::variant<int, double, bool, char, std::string_view>& literal);
+
+int to_int(const Value& value);         // bool и char - целые, как в си
+double to_double(const Value& value);
+bool truth(const Value& value);
+Object* to_object(const Value& value);
+
+// бинарный оператор ADD..SHR над числами: два целых - целое по модулю 2^32, иначе double
+Value arithmetic(OpKind oper, const Value& left, const Value& right);
+Value unary(OpKind oper, const Value& operand);  // ADD, SUB, NOT, BIT_NOT
+
+// присваивание приводит значение к типу цели - тип задан значением, которое уже в ней.
+// массивы и структуры копируются поэлементно
+void assign(Value& target, const Value& source);
+
+int size_of(const Value& value);
+void print(std::ostream& out, const Value& value);
+bool read(std::istream& in, Value& target);     // по типу target; false - не прочиталось
+
+}
@@ -2,6 +2,16 @@
 
 #include "ast.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
 struct ASTVisitor {
     virtual void visit(TernaryExprNode& node) = 0;
     virtual void visit(BinaryExprNode& node) = 0;
@@ -23,7 +33,7 @@ struct ASTVisitor {
     virtual void visit(BlockStatmNode& node) = 0;
     virtual void visit(ForStatmNode& node) = 0;
     virtual void visit(WhileStatmNode& node) = 0;
-    virtual void visit(InStatmNode& node) = 0;
+    virtual void visit(InputStatmNode& node) = 0;
     virtual void visit(OutStatmNode& node) = 0;
     virtual void visit(SZFStatmNode& node) = 0;
     virtual void visit(ExitStatmNode& node) = 0;
@@ -38,7 +48,271 @@ struct ASTVisitor {
     virtual ~ASTVisitor() = default;
 };
 
-struct PrintVisitor : ASTVisitor {
+// статический обход: по ASTNode::kind выбирается dispatch<узел>, куда f(конкретный узел&)
+// встраивается, - один косвенный вызов на узел вместо accept + visit. таблица, а не switch:
+// вызов из таблицы встраивается в каждое место обхода, и переход у каждого места свой -
+// единый switch на всю рекурсию предсказывается хуже и был медленнее виртуального обхода.
+// f перегружает operator() только для нужных узлов (или берет шаблонный вариант для всех),
+// остальные пропускаются - тогда f должен возвращать void
+namespace visit_detail {
+
+template <typename Node, typename F>
+decltype(auto) dispatch(ASTNode& node, F& f) {
+    if constexpr (std::is_invocable_v<F&, Node&>) return f(static_cast<Node&>(node));
+}
+
+}
+
+template <typename F>
+decltype(auto) visit(ASTNode& node, F&& f) {
+    using visit_detail::dispatch;
+    using R = decltype(dispatch<ASTRootNode>(node, f));
+    static constexpr R (*table[])(ASTNode&, F&) = {     // в порядке NodeKind
+        &dispatch<TernaryExprNode, F&>,
+        &dispatch<BinaryExprNode, F&>,
+        &dispatch<UnaryExprNode, F&>,
+        &dispatch<AssignExprNode, F&>,
+        &dispatch<PostfixExprNode, F&>,
+        &dispatch<LiteralExprNode, F&>,
+        &dispatch<IdExprNode, F&>,
+        &dispatch<MemberAccessExprNode, F&>,
+        &dispatch<CallExprNode, F&>,
+        &dispatch<ArrayAccessExprNode, F&>,
+        &dispatch<ArrayInitExprNode, F&>,
+        &dispatch<ReturnStatmNode, F&>,
+        &dispatch<BreakStatmNode, F&>,
+        &dispatch<ContinueStatmNode, F&>,
+        &dispatch<ConditionStatmNode, F&>,
+        &dispatch<ExprStatmNode, F&>,
+        &dispatch<BlockStatmNode, F&>,
+        &dispatch<ForStatmNode, F&>,
+        &dispatch<WhileStatmNode, F&>,
+        &dispatch<InputStatmNode, F&>,
+        &dispatch<OutStatmNode, F&>,
+        &dispatch<SZFStatmNode, F&>,
+        &dispatch<ExitStatmNode, F&>,
+        &dispatch<VarDeclNode, F&>,
+        &dispatch<FuncDeclNode, F&>,
+        &dispatch<StructDeclNode, F&>,
+        &dispatch<AssertDeclNode, F&>,
+        &dispatch<ASTRootNode, F&>
+    };
+    static_assert(std::size(table) == static_cast<std::size_t>(NodeKind::ROOT) + 1);
+    return table[static_cast<std::size_t>(node.kind)](node, f);
+}
+
+// f(ASTNode&) для каждого непустого прямого потомка node, в порядке исходника
+template <typename Node, typename F>
+void for_each_child(Node& node, F&& f) {
+    auto each = [&f](ASTNode* child) { if (child) f(*child); };
+    if constexpr (std::is_same_v<Node, ASTNode>) {
+        visit(node, [&f](auto& concrete) { for_each_child(concrete, f); });
+    } else if constexpr (std::is_same_v<Node, TernaryExprNode>) {
+        each(node.condition); each(node.true_expr); each(node.false_expr);
+    } else if constexpr (std::is_same_v<Node, BinaryExprNode> || std::is_same_v<Node, AssignExprNode>) {
+        each(node.left); each(node.right);
+    } else if constexpr (std::is_same_v<Node, UnaryExprNode> || std::is_same_v<Node, PostfixExprNode>) {
+        each(node.operand);
+    } else if constexpr (std::is_same_v<Node, MemberAccessExprNode>) {
+        each(node.object);
+    } else if constexpr (std::is_same_v<Node, CallExprNode>) {
+        each(node.called);
+        for (auto* argument : node.arguments) each(argument);
+    } else if constexpr (std::is_same_v<Node, ArrayAccessExprNode>) {
+        each(node.array); each(node.index);
+    } else if constexpr (std::is_same_v<Node, ArrayInitExprNode>) {
+        for (auto* element : node.elements) each(element);
+    } else if constexpr (std::is_same_v<Node, ConditionStatmNode>) {
+        each(node.condition); each(node.then_statm); each(node.else_statm);
+    } else if constexpr (std::is_same_v<Node, BlockStatmNode> || std::is_same_v<Node, ASTRootNode>) {
+        for (auto* statement : node.statements) each(statement);
+    } else if constexpr (std::is_same_v<Node, ForStatmNode>) {
+        each(node.init); each(node.condition); each(node.incr); each(node.body);
+    } else if constexpr (std::is_same_v<Node, WhileStatmNode>) {
+        each(node.condition); each(node.body);
+    } else if constexpr (std::is_same_v<Node, VarDeclNode>) {
+        for (auto& var : node.variables) { each(var.size); each(var.init); }
+    } else if constexpr (std::is_same_v<Node, FuncDeclNode>) {
+        each(node.body);
+    } else if constexpr (std::is_same_v<Node, StructDeclNode>) {
+        for (auto* field : node.fields) each(field);
+    } else if constexpr (requires { node.expr; }) {
+        each(node.expr);    // Return, ExprStatm, Input, Out, Sizeof, Exit, Assert
+    }
+}
+
+namespace visit_detail {
+
+// глубже этого walk переходит со стека вызовов на явный стек в куче
+inline constexpr std::size_t WALK_DEPTH = 256;
+
+template <typename F>
+void walk_deep(ASTNode& root, F& f) {
+    std::vector<ASTNode*> work{&root};
+    auto later = [&work](ASTNode& child) { work.push_back(&child); };
+    while (!work.empty()) {
+        ASTNode* node = work.back();
+        work.pop_back();
+        std::size_t mark = work.size();
+        visit(*node, [&f, &later](auto& concrete) {
+            if constexpr (std::is_invocable_v<F&, decltype(concrete)>) f(concrete);
+            for_each_child(concrete, later);
+        });
+        std::reverse(work.begin() + mark, work.end());
+    }
+}
+
+// один тип посетителя на все уровни: переход к ребенку - один косвенный вызов через visit
+template <typename F>
+struct Walker {
+    F& f;
+    std::size_t depth;
+
+    template <typename Node>
+    void operator()(Node& node) const {
+        if constexpr (std::is_invocable_v<F&, Node&>) f(node);
+        for_each_child(node, [this](ASTNode& child) {
+            if (depth + 1 == WALK_DEPTH) walk_deep(child, f);
+            else visit(child, Walker{f, depth + 1});
+        });
+    }
+};
+
+}
+
+// обход в прямом порядке: f(узел&) для каждого узла, если f его принимает, потомки - в порядке
+// исходника. первые WALK_DEPTH уровней - обычной рекурсией (на плоских деревьях она быстрее
+// вектора-стека), глубже - явным стеком в куче
+template <typename F>
+void walk(ASTNode& root, F&& f) {
+    visit(root, visit_detail::Walker<std::remove_reference_t<F>>{f, 0});
+}
+
+// f(ExprNode&) для каждого операнда выражения - подвыражения, чье значение ему нужно: дети из
+// for_each_child, кроме имени вызываемой функции
+template <typename Node, typename F>
+void for_each_operand(Node& node, F&& f) {
+    if constexpr (std::is_same_v<Node, CallExprNode>) {
+        for (auto* argument : node.arguments) {
+            if (argument) f(*argument);
+        }
+    } else {
+        for_each_child(node, [&f](ASTNode& child) { f(static_cast<ExprNode&>(child)); });
+    }
+}
+
+// обход выражения в обратном порядке явным стеком: f(узел&, число операндов) для каждого узла
+// после всех его операндов, операнды - в порядке исходника. выражение из файла может быть
+// сколь угодно глубоким, а явный стек растет в куче - рекурсия по нему переполнила бы стек
+// вызовов. результаты операндов удобно держать в OperandStack
+template <typename F>
+void post_order(ExprNode& root, F&& f) {
+    struct Item {
+        ExprNode* node;
+        std::uint32_t operands;
+        bool ready;
+    };
+    std::vector<Item> work{{&root, 0, false}};
+    while (!work.empty()) {
+        Item item = work.back();
+        work.pop_back();
+        visit(*item.node, [&](auto& concrete) {
+            if constexpr (std::is_base_of_v<ExprNode, std::remove_reference_t<decltype(concrete)>>) {
+                if (item.ready) {
+                    f(concrete, std::size_t{item.operands});
+                    return;
+                }
+                std::size_t mark = work.size() + 1;
+                work.push_back({item.node, 0, true});
+                for_each_operand(concrete, [&work](ExprNode& operand) { work.push_back({&operand, 0, false}); });
+                work[mark - 1].operands = static_cast<std::uint32_t>(work.size() - mark);
+                std::reverse(work.begin() + mark, work.end());
+            }
+        });
+    }
+}
+
+// результаты операндов для post_order стопкой: у узла они - последние положенные. run
+// вызывает f(узел&) после его операндов, те видны как operands[i], а то, что f вернет,
+// занимает их место; итог - результат корня. посетитель держит стопку полем, чтобы его
+// operator() для узлов читали операнды сами, не спускаясь к ним
+template <typename T>
+class OperandStack {
+public:
+    template <typename F>
+    T run(ExprNode& root, F&& f) {
+        results.clear();
+        post_order(root, [&](auto& node, std::size_t operands) {
+            first = results.size() - operands;
+            T result = f(node);
+            results.resize(first);
+            results.push_back(std::move(result));
+        });
+        return results.back();
+    }
+
+    const T& operator[](std::size_t i) const { return results[first + i]; }
+
+private:
+    std::vector<T> results;
+    std::size_t first = 0;
+};
+
+// печать дерева через print(): operator() печатает начало узла, а детей и остальной
+// текст откладывает в work по порядку, без рекурсии
+struct PrintVisitor {
+    void print(ASTNode& root);
+
+    void operator()(TernaryExprNode& node);
+    void operator()(BinaryExprNode& node);
+    void operator()(UnaryExprNode& node);
+    void operator()(AssignExprNode& node);
+    void operator()(PostfixExprNode& node);
+    void operator()(LiteralExprNode& node);
+    void operator()(IdExprNode& node);
+    void operator()(MemberAccessExprNode& node);
+    void operator()(CallExprNode& node);
+    void operator()(ArrayAccessExprNode& node);
+    void operator()(ArrayInitExprNode& node);
+
+    void operator()(ReturnStatmNode& node);
+    void operator()(BreakStatmNode& node);
+    void operator()(ContinueStatmNode& node);
+    void operator()(ConditionStatmNode& node);
+    void operator()(ExprStatmNode& node);
+    void operator()(BlockStatmNode& node);
+    void operator()(ForStatmNode& node);
+    void operator()(WhileStatmNode& node);
+    void operator()(InputStatmNode& node);
+    void operator()(OutStatmNode& node);
+    void operator()(SZFStatmNode& node);
+    void operator()(ExitStatmNode& node);
+
+    void operator()(VarDeclNode& node);
+    void operator()(FuncDeclNode& node);
+    void operator()(StructDeclNode& node);
+    void operator()(AssertDeclNode& node);
+
+    void operator()(ASTRootNode& node);
+
+private:
+    struct Item {
+        ASTNode* node;          // nullptr - напечатать text
+        std::string_view text;
+    };
+    std::vector<Item> work;
+
+    void then(ASTNode* node);   // пустой узел пропускается
+    void then(std::string_view text);
+};
+
+// дерево в двоичный формат кэша (см. ast_cache.hpp): записи узлов в обратном порядке обхода,
+// дети раньше родителя и указываются расстоянием назад в записях, имена и строки - номером
+// в таблице строк в конце файла. отложенные тела функций должны быть уже разобраны.
+// обход в write_tree - без рекурсии, visit только пишет запись уже записанных детей
+struct SerializeVisitor : ASTVisitor {
+    void write_tree(ASTNode& root);
+
     void visit(TernaryExprNode& node) override;
     void visit(BinaryExprNode& node) override;
     void visit(UnaryExprNode& node) override;
@@ -59,7 +333,7 @@ struct PrintVisitor : ASTVisitor {
     void visit(BlockStatmNode& node) override;
     void visit(ForStatmNode& node) override;
     void visit(WhileStatmNode& node) override;
-    void visit(InStatmNode& node) override;
+    void visit(InputStatmNode& node) override;
     void visit(OutStatmNode& node) override;
     void visit(SZFStatmNode& node) override;
     void visit(ExitStatmNode& node) override;
@@ -70,4 +344,23 @@ struct PrintVisitor : ASTVisitor {
     void visit(AssertDeclNode& node) override;
 
     void visit(ASTRootNode& node) override;
+
+    std::string finish();       // заголовок + записи + таблица строк
+
+private:
+    std::string records;
+    std::uint32_t count = 0;                        // записано узлов
+    std::uint32_t last = 0;                         // номер последней записи + 1, 0 - нет узла
+    std::unordered_map<std::string_view, std::uint32_t> string_ids;
+    std::vector<std::string_view> strings;
+
+    std::vector<std::uint32_t> written;             // номера + 1 записанных детей ждущих узлов
+    std::size_t next_child = 0;                     // следующий из written для write()
+
+    std::uint32_t write(ASTNode* node);             // номер + 1 уже записанного ребенка, 0 - нет узла
+    void begin(std::uint8_t kind);
+    void ref(std::uint32_t child);
+    void u8(std::uint8_t value);
+    void u32(std::uint32_t value);
+    void string(std::string_view text);
 };
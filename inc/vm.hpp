@@ -0,0 +1,47 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+// выполнение байткода. регистры всех кадров - один стек значений, кадр вызванной функции
+// начинается сразу за кадром вызывающей, вызовы - вектор Frame, без рекурсии C++.
+// выбор инструкции - computed goto на GCC и Clang, иначе switch; VM_SWITCH_DISPATCH
+// включает switch и там. ADD..GEQ переписываются на месте в формы для int или float по типам
+// операндов, которые встретились при выполнении (поэтому Module не константный); форма, которой
+// попались другие типы, возвращается к общей. семантика значений общая с EvalVisitor (values::),
+// ошибка - std::runtime_error
+class VM {
+public:
+    static constexpr std::size_t STACK_SLOTS = 1 << 20;
+
+    VM(Module& module, std::istream& in, std::ostream& out);
+
+    // код выхода - значение exit(...) или того, что вернула main. count - считать выбранные
+    // инструкции в dispatches()
+    int run(bool count = false);
+    std::uint64_t dispatches() const { return dispatched; }
+
+private:
+    struct Frame {
+        const Function* function;   // вызывающая функция и где продолжить
+        Instr* pc;
+        Value* registers;
+        std::size_t heap_mark;      // куча до вызова
+        Reg result;                 // регистр вызывающей под результат
+    };
+
+    Module& module;
+    std::istream& in;
+    std::ostream& out;
+    std::unique_ptr<Value[]> stack;
+    std::vector<Value> globals;
+    std::vector<Frame> frames;
+    Heap heap;
+    std::uint64_t dispatched = 0;
+};
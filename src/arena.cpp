@@ -0,0 +1,26 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+void* AstArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    auto aligned = [alignment](std::byte* p) {
+        auto address = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(alignment - 1));
+    };
+
+    std::byte* start = cursor ? aligned(cursor) : nullptr;
+    if (!start || start + bytes > limit) {
+        // блоки растут вдвое до MAX_BLOCK; крупный запрос получает блок по размеру
+        std::size_t size = std::max(next_block, bytes + alignment);
+        next_block = std::min(next_block * 2, MAX_BLOCK);
+        blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        bytes_reserved += size;
+        cursor = blocks.back().get();
+        limit = cursor + size;
+        start = aligned(cursor);
+    }
+    cursor = start + bytes;
+    bytes_used += bytes;
+    return start;
+}
@@ -0,0 +1,622 @@
+#include "ast_cache.hpp"
+#include "visitor.hpp"
+#include "symbol.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using namespace ast_cache;
+
+// === Запись ===
+
+// обратный порядок обхода на явном стеке: узел снимается второй раз, когда все его дети
+// записаны и их номера лежат в конце written в порядке for_each_child - в том же порядке
+// visit забирает их через write()
+void SerializeVisitor::write_tree(ASTNode& root) {
+    struct Pending {
+        ASTNode* node;
+        bool expanded;
+    };
+    std::vector<Pending> work{{&root, false}};
+    while (!work.empty()) {
+        Pending& top = work.back();
+        ASTNode* node = top.node;
+        if (!top.expanded) {
+            top.expanded = true;
+            std::size_t mark = work.size();
+            for_each_child(*node, [&work](ASTNode& child) { work.push_back({&child, false}); });
+            std::reverse(work.begin() + mark, work.end());
+            continue;
+        }
+        work.pop_back();
+        std::size_t children = 0;
+        for_each_child(*node, [&children](ASTNode&) { ++children; });
+        next_child = written.size() - children;
+        node->accept(*this);
+        written.resize(written.size() - children);
+        written.push_back(last);
+    }
+}
+
+std::uint32_t SerializeVisitor::write(ASTNode* node) {
+    return node ? written[next_child++] : 0;
+}
+
+void SerializeVisitor::begin(std::uint8_t kind) {
+    last = ++count;
+    u8(kind);
+}
+
+void SerializeVisitor::ref(std::uint32_t child) {
+    u32(child ? last - child : 0);
+}
+
+void SerializeVisitor::u8(std::uint8_t value) {
+    records.push_back(static_cast<char>(value));
+}
+
+void SerializeVisitor::u32(std::uint32_t value) {
+    records.append(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+void SerializeVisitor::string(std::string_view text) {
+    auto [it, inserted] = string_ids.try_emplace(text, static_cast<std::uint32_t>(strings.size()));
+    if (inserted) strings.push_back(text);
+    u32(it->second);
+}
+
+std::string SerializeVisitor::finish() {
+    std::string out(HEADER_SIZE, '\0');
+    std::memcpy(out.data(), MAGIC.data(), MAGIC.size());
+    std::uint32_t header[3] = {FORMAT_VERSION, count, static_cast<std::uint32_t>(strings.size())};
+    std::memcpy(out.data() + 8, header, sizeof header);
+    std::uint64_t strings_offset = HEADER_SIZE + records.size();
+    std::memcpy(out.data() + 24, &strings_offset, sizeof strings_offset);
+
+    out += records;
+    for (auto text : strings) {
+        auto size = static_cast<std::uint32_t>(text.size());
+        out.append(reinterpret_cast<const char*>(&size), sizeof size);
+        out += text;
+    }
+    return out;
+}
+
+void SerializeVisitor::visit(TernaryExprNode& node) {
+    auto condition = write(node.condition), true_expr = write(node.true_expr), false_expr = write(node.false_expr);
+    begin(TERNARY);
+    ref(condition); ref(true_expr); ref(false_expr);
+}
+
+void SerializeVisitor::visit(BinaryExprNode& node) {
+    auto left = write(node.left), right = write(node.right);
+    begin(BINARY);
+    u8(static_cast<std::uint8_t>(node.oper));
+    ref(left); ref(right);
+}
+
+void SerializeVisitor::visit(UnaryExprNode& node) {
+    auto operand = write(node.operand);
+    begin(UNARY);
+    u8(static_cast<std::uint8_t>(node.oper));
+    ref(operand);
+}
+
+void SerializeVisitor::visit(AssignExprNode& node) {
+    auto left = write(node.left), right = write(node.right);
+    begin(ASSIGN);
+    u8(static_cast<std::uint8_t>(node.oper));
+    ref(left); ref(right);
+}
+
+void SerializeVisitor::visit(PostfixExprNode& node) {
+    auto operand = write(node.operand);
+    begin(POSTFIX);
+    u8(static_cast<std::uint8_t>(node.oper));
+    ref(operand);
+}
+
+void SerializeVisitor::visit(LiteralExprNode& node) {
+    begin(LITERAL);
+    std::visit([this](auto value) {
+        using T = decltype(value);
+        if constexpr (std::is_same_v<T, int>) {
+            u8(INT);
+            u32(static_cast<std::uint32_t>(value));
+        } else if constexpr (std::is_same_v<T, double>) {
+            u8(DOUBLE);
+            records.append(reinterpret_cast<const char*>(&value), sizeof value);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            u8(BOOL);
+            u8(value);
+        } else if constexpr (std::is_same_v<T, char>) {
+            u8(CHAR);
+            u8(static_cast<std::uint8_t>(value));
+        } else {
+            u8(STRING);
+            string(value);
+        }
+    }, node.value);
+}
+
+void SerializeVisitor::visit(IdExprNode& node) {
+    begin(ID);
+    string(symbols::name(node.name));
+}
+
+void SerializeVisitor::visit(MemberAccessExprNode& node) {
+    auto object = write(node.object);
+    begin(MEMBER);
+    ref(object);
+    string(symbols::name(node.member));
+}
+
+void SerializeVisitor::visit(CallExprNode& node) {
+    auto called = write(node.called);
+    std::vector<std::uint32_t> arguments;
+    for (auto* argument : node.arguments) arguments.push_back(write(argument));
+    begin(CALL);
+    ref(called);
+    u32(static_cast<std::uint32_t>(arguments.size()));
+    for (auto argument : arguments) ref(argument);
+}
+
+void SerializeVisitor::visit(ArrayAccessExprNode& node) {
+    auto array = write(node.array), index = write(node.index);
+    begin(INDEX);
+    ref(array); ref(index);
+}
+
+void SerializeVisitor::visit(ArrayInitExprNode& node) {
+    std::vector<std::uint32_t> elements;
+    for (auto* element : node.elements) elements.push_back(write(element));
+    begin(ARRAY_INIT);
+    u32(static_cast<std::uint32_t>(elements.size()));
+    for (auto element : elements) ref(element);
+}
+
+void SerializeVisitor::visit(ReturnStatmNode& node) {
+    auto expr = write(node.expr);
+    begin(RETURN);
+    ref(expr);
+}
+
+void SerializeVisitor::visit(BreakStatmNode&) {
+    begin(BREAK);
+}
+
+void SerializeVisitor::visit(ContinueStatmNode&) {
+    begin(CONTINUE);
+}
+
+void SerializeVisitor::visit(ConditionStatmNode& node) {
+    auto condition = write(node.condition), then_statm = write(node.then_statm), else_statm = write(node.else_statm);
+    begin(CONDITION);
+    ref(condition); ref(then_statm); ref(else_statm);
+}
+
+void SerializeVisitor::visit(ExprStatmNode& node) {
+    auto expr = write(node.expr);
+    begin(EXPR_STATM);
+    ref(expr);
+}
+
+void SerializeVisitor::visit(BlockStatmNode& node) {
+    std::vector<std::uint32_t> statements;
+    for (auto* statement : node.statements) statements.push_back(write(statement));
+    begin(BLOCK);
+    u32(static_cast<std::uint32_t>(statements.size()));
+    for (auto statement : statements) ref(statement);
+}
+
+void SerializeVisitor::visit(ForStatmNode& node) {
+    auto init = write(node.init), condition = write(node.condition), incr = write(node.incr), body = write(node.body);
+    begin(FOR);
+    ref(init); ref(condition); ref(incr); ref(body);
+}
+
+void SerializeVisitor::visit(WhileStatmNode& node) {
+    auto condition = write(node.condition), body = write(node.body);
+    begin(WHILE);
+    ref(condition); ref(body);
+    u8(node.do_while);
+}
+
+void SerializeVisitor::visit(InputStatmNode& node) {
+    auto expr = write(node.expr);
+    begin(INPUT);
+    ref(expr);
+}
+
+void SerializeVisitor::visit(OutStatmNode& node) {
+    auto expr = write(node.expr);
+    begin(OUT);
+    ref(expr);
+}
+
+void SerializeVisitor::visit(SZFStatmNode& node) {
+    auto expr = write(node.expr);
+    begin(SIZEOF);
+    ref(expr);
+}
+
+void SerializeVisitor::visit(ExitStatmNode& node) {
+    auto expr = write(node.expr);
+    begin(EXIT);
+    ref(expr);
+}
+
+void SerializeVisitor::visit(VarDeclNode& node) {
+    std::vector<std::uint32_t> children;
+    for (const auto& var : node.variables) {
+        children.push_back(write(var.size));
+        children.push_back(write(var.init));
+    }
+    begin(VAR_DECL);
+    string(symbols::name(node.type));
+    u8(node.constant);
+    u32(static_cast<std::uint32_t>(node.variables.size()));
+    for (std::size_t i = 0; i < node.variables.size(); ++i) {
+        string(symbols::name(node.variables[i].name));
+        ref(children[2 * i + 1]);
+        ref(children[2 * i]);
+    }
+}
+
+void SerializeVisitor::visit(FuncDeclNode& node) {
+    if (node.pending())
+        throw std::runtime_error("тело функции " + std::string(symbols::name(node.func_name)) + " не разобрано");
+    auto body = write(node.body);
+    begin(FUNC_DECL);
+    string(symbols::name(node.func_type));
+    string(symbols::name(node.func_name));
+    u32(static_cast<std::uint32_t>(node.parameters.size()));
+    for (const auto& [type, name] : node.parameters) {
+        string(symbols::name(type));
+        string(symbols::name(name));
+    }
+    ref(body);
+}
+
+void SerializeVisitor::visit(StructDeclNode& node) {
+    std::vector<std::uint32_t> fields;
+    for (auto* field : node.fields) fields.push_back(write(field));
+    begin(STRUCT_DECL);
+    string(symbols::name(node.name));
+    u32(static_cast<std::uint32_t>(fields.size()));
+    for (auto field : fields) ref(field);
+}
+
+void SerializeVisitor::visit(AssertDeclNode& node) {
+    auto expr = write(node.expr);
+    begin(ASSERT);
+    ref(expr);
+    if (node.message.empty()) u32(NO_STRING);
+    else string(node.message);
+}
+
+void SerializeVisitor::visit(ASTRootNode& node) {
+    std::vector<std::uint32_t> statements;
+    for (auto* statement : node.statements) statements.push_back(write(statement));
+    begin(ROOT);
+    u32(static_cast<std::uint32_t>(statements.size()));
+    for (auto statement : statements) ref(statement);
+}
+
+// === Чтение ===
+
+namespace {
+
+bool is_expr(std::uint8_t kind) { return kind <= ARRAY_INIT; }
+bool is_statm(std::uint8_t kind) { return kind >= RETURN && kind <= EXIT; }
+bool is_decl(std::uint8_t kind) { return kind >= VAR_DECL && kind <= ASSERT; }
+
+class Reader {
+public:
+    Reader(std::string_view data, AstArena& arena) : data(data), arena(arena) {}
+
+    ASTRootNode* read() {
+        if (data.size() < HEADER_SIZE || data.substr(0, MAGIC.size()) != MAGIC) corrupt();
+        pos = MAGIC.size();
+        if (u32() != FORMAT_VERSION) corrupt();
+        std::uint32_t count = u32();
+        std::uint32_t string_count = u32();
+        u32();
+        std::uint64_t strings_offset = u64();
+        if (strings_offset > data.size() || count == 0) corrupt();
+
+        // сначала строки: они нужны записям по номеру
+        std::size_t records_end = static_cast<std::size_t>(strings_offset);
+        pos = records_end;
+        strings.reserve(string_count);
+        for (std::uint32_t i = 0; i < string_count; ++i) {
+            std::uint32_t size = u32();
+            need(size);
+            strings.push_back(symbols::intern(data.substr(pos, size)));
+            pos += size;
+        }
+
+        pos = HEADER_SIZE;
+        nodes.resize(count);
+        kinds.resize(count);
+        for (index = 0; index < count; ++index) {
+            kinds[index] = u8();
+            nodes[index] = record(kinds[index]);
+        }
+        if (pos != records_end || kinds.back() != ROOT) corrupt();
+        return static_cast<ASTRootNode*>(nodes.back());
+    }
+
+private:
+    std::string_view data;
+    AstArena& arena;
+    std::size_t pos = 0;
+    std::uint32_t index = 0;
+    std::vector<Symbol> strings;
+    std::vector<ASTNode*> nodes;
+    std::vector<std::uint8_t> kinds;
+
+    [[noreturn]] static void corrupt() {
+        throw std::runtime_error("кэш AST поврежден");
+    }
+
+    void need(std::size_t bytes) const {
+        if (bytes > data.size() - pos) corrupt();
+    }
+
+    template <typename T>
+    T scalar() {
+        need(sizeof(T));
+        T value;
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    std::uint8_t u8() { return scalar<std::uint8_t>(); }
+    std::uint32_t u32() { return scalar<std::uint32_t>(); }
+    std::uint64_t u64() { return scalar<std::uint64_t>(); }
+
+    Symbol symbol() {
+        std::uint32_t id = u32();
+        if (id >= strings.size()) corrupt();
+        return strings[id];
+    }
+
+    std::string_view text() { return symbols::name(symbol()); }
+
+    OpKind op() {
+        std::uint8_t value = u8();
+        if (value >= static_cast<std::uint8_t>(OpKind::NONE)) corrupt();
+        return static_cast<OpKind>(value);
+    }
+
+    // ссылка назад на уже прочитанную запись с проверкой вида узла
+    template <typename T>
+    T* node() {
+        std::uint32_t distance = u32();
+        if (distance == 0) return nullptr;
+        if (distance > index) corrupt();
+        std::uint32_t child = index - distance;
+        std::uint8_t kind = kinds[child];
+        bool fits;
+        if constexpr (std::is_same_v<T, ExprNode>) fits = is_expr(kind);
+        else if constexpr (std::is_same_v<T, StatmNode>) fits = is_statm(kind);
+        else if constexpr (std::is_same_v<T, DeclNode>) fits = is_decl(kind);
+        else if constexpr (std::is_same_v<T, BlockStatmNode>) fits = kind == BLOCK;
+        else if constexpr (std::is_same_v<T, VarDeclNode>) fits = kind == VAR_DECL;
+        else fits = kind != ROOT;
+        if (!fits) corrupt();
+        return static_cast<T*>(nodes[child]);
+    }
+
+    template <typename T>
+    std::pmr::vector<T*> list() {
+        std::uint32_t size = u32();
+        need(std::size_t(size) * sizeof(std::uint32_t));
+        std::pmr::vector<T*> items(&arena);
+        items.reserve(size);
+        for (std::uint32_t i = 0; i < size; ++i) items.push_back(node<T>());
+        return items;
+    }
+
+    ASTNode* record(std::uint8_t kind) {
+        switch (kind) {
+            case TERNARY: {
+                auto condition = node<ExprNode>();
+                auto true_expr = node<ExprNode>();
+                return arena.make<TernaryExprNode>(condition, true_expr, node<ExprNode>());
+            }
+            case BINARY: {
+                auto oper = op();
+                auto left = node<ExprNode>();
+                return arena.make<BinaryExprNode>(oper, left, node<ExprNode>());
+            }
+            case UNARY: {
+                auto oper = op();
+                return arena.make<UnaryExprNode>(oper, node<ExprNode>());
+            }
+            case ASSIGN: {
+                auto oper = op();
+                auto left = node<ExprNode>();
+                return arena.make<AssignExprNode>(oper, left, node<ExprNode>());
+            }
+            case POSTFIX: {
+                auto oper = op();
+                return arena.make<PostfixExprNode>(oper, node<ExprNode>());
+            }
+            case LITERAL:
+                switch (u8()) {
+                    case INT: return arena.make<LiteralExprNode>(static_cast<int>(u32()));
+                    case DOUBLE: return arena.make<LiteralExprNode>(scalar<double>());
+                    case BOOL: return arena.make<LiteralExprNode>(u8() != 0);
+                    case CHAR: return arena.make<LiteralExprNode>(static_cast<char>(u8()));
+                    case STRING: return arena.make<LiteralExprNode>(text());
+                    default: corrupt();
+                }
+            case ID:
+                return arena.make<IdExprNode>(symbol());
+            case MEMBER: {
+                auto object = node<ExprNode>();
+                return arena.make<MemberAccessExprNode>(object, symbol());
+            }
+            case CALL: {
+                auto called = node<ExprNode>();
+                return arena.make<CallExprNode>(called, list<ExprNode>());
+            }
+            case INDEX: {
+                auto array = node<ExprNode>();
+                return arena.make<ArrayAccessExprNode>(array, node<ExprNode>());
+            }
+            case ARRAY_INIT:
+                return arena.make<ArrayInitExprNode>(list<ExprNode>());
+            case RETURN:
+                return arena.make<ReturnStatmNode>(node<StatmNode>());
+            case BREAK:
+                return arena.make<BreakStatmNode>();
+            case CONTINUE:
+                return arena.make<ContinueStatmNode>();
+            case CONDITION: {
+                auto condition = node<ExprNode>();
+                auto then_statm = node<StatmNode>();
+                return arena.make<ConditionStatmNode>(condition, then_statm, node<StatmNode>());
+            }
+            case EXPR_STATM:
+                return arena.make<ExprStatmNode>(node<ASTNode>());
+            case BLOCK:
+                return arena.make<BlockStatmNode>(list<StatmNode>());
+            case FOR: {
+                auto init = node<ASTNode>();
+                auto condition = node<ExprNode>();
+                auto incr = node<ExprNode>();
+                return arena.make<ForStatmNode>(init, condition, incr, node<StatmNode>());
+            }
+            case WHILE: {
+                auto condition = node<ExprNode>();
+                auto body = node<StatmNode>();
+                return arena.make<WhileStatmNode>(condition, body, u8() != 0);
+            }
+            case INPUT:
+                return arena.make<InputStatmNode>(node<StatmNode>());
+            case OUT:
+                return arena.make<OutStatmNode>(node<StatmNode>());
+            case SIZEOF:
+                return arena.make<SZFStatmNode>(node<ExprNode>());
+            case EXIT:
+                return arena.make<ExitStatmNode>(node<ExprNode>());
+            case VAR_DECL: {
+                auto type = symbol();
+                bool constant = u8();
+                std::uint32_t size = u32();
+                need(std::size_t(size) * 3 * sizeof(std::uint32_t));
+                std::pmr::vector<VariableNode> variables(&arena);
+                variables.reserve(size);
+                for (std::uint32_t i = 0; i < size; ++i) {
+                    auto name = symbol();
+                    auto init = node<ExprNode>();
+                    variables.emplace_back(name, init, node<ExprNode>());
+                }
+                return arena.make<VarDeclNode>(type, std::move(variables), constant);
+            }
+            case FUNC_DECL: {
+                auto func_type = symbol();
+                auto func_name = symbol();
+                std::uint32_t size = u32();
+                need(std::size_t(size) * 2 * sizeof(std::uint32_t));
+                std::pmr::vector<std::pair<Symbol, Symbol>> parameters(&arena);
+                parameters.reserve(size);
+                for (std::uint32_t i = 0; i < size; ++i) {
+                    auto type = symbol();
+                    parameters.emplace_back(type, symbol());
+                }
+                return arena.make<FuncDeclNode>(func_type, func_name, std::move(parameters), node<BlockStatmNode>());
+            }
+            case STRUCT_DECL: {
+                auto name = symbol();
+                return arena.make<StructDeclNode>(name, list<VarDeclNode>());
+            }
+            case ASSERT: {
+                auto expr = node<ExprNode>();
+                std::uint32_t message = u32();
+                if (message == NO_STRING) return arena.make<AssertDeclNode>(expr, std::string_view{});
+                if (message >= strings.size()) corrupt();
+                return arena.make<AssertDeclNode>(expr, symbols::name(strings[message]));
+            }
+            case ROOT:
+                return arena.make<ASTRootNode>(list<ASTNode>());
+            default:
+                corrupt();
+        }
+    }
+};
+
+}
+
+namespace ast_cache {
+
+std::string serialize(ASTNode& root) {
+    SerializeVisitor writer;
+    writer.write_tree(root);
+    return writer.finish();
+}
+
+ASTRootNode* deserialize(std::string_view data, AstArena& arena) {
+    return Reader(data, arena).read();
+}
+
+}
+
+// === Кэш ===
+
+AstCache::AstCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string AstCache::path(const SourceBuffer& source) const {
+    // версия компилятора входит в ключ: другая сборка может иначе разбирать тот же текст
+    std::size_t text = std::hash<std::string_view>{}(source.view());
+    std::size_t version = std::hash<std::string_view>{}(__VERSION__) ^ FORMAT_VERSION;
+    char name[64];
+    std::snprintf(name, sizeof name, "%016zx-%016zx.ast", text, version);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+// битый или недописанный файл - как промах: дерево разберется заново и запись перепишется
+ASTRootNode* AstCache::load(const SourceBuffer& source, AstArena& arena) const {
+    std::string file = path(source);
+    std::error_code error;
+    if (!std::filesystem::exists(file, error)) return nullptr;
+    try {
+        auto data = SourceBuffer::map_file(file);
+        return deserialize(data->view(), arena);
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
+}
+
+// кэш - только ускорение: не получилось записать - предупреждение, программа идет дальше
+void AstCache::store(const SourceBuffer& source, ASTNode& root) const {
+    std::string data = serialize(root);
+    // через временный файл: параллельный запуск не увидит запись наполовину
+    std::string file = path(source);
+    std::string temporary = file + ".tmp" + std::to_string(std::hash<std::string>{}(data));
+    try {
+        std::filesystem::create_directories(directory);
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!out) throw std::runtime_error("Не получилось записать кэш AST: " + temporary);
+        }
+        std::filesystem::rename(temporary, file);
+    } catch (const std::runtime_error& e) {
+        std::error_code error;
+        std::filesystem::remove(temporary, error);
+        std::cerr << "Предупреждение: " << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,92 @@
+#include "bytecode.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+constexpr OpInfo infos[] = {
+#define VM_INFO(name, a, b, c) {#name, Operand::a, Operand::b, Operand::c},
+    VM_OPCODES(VM_INFO)
+#undef VM_INFO
+};
+
+const char* type_name(Reg type) {
+    static const char* const names[] = {"int", "float", "char", "bool", "void"};
+    if (type == NO_TYPE) return "-";
+    return type < std::size(names) ? names[type] : "struct";
+}
+
+// символ в кавычках, как в исходнике; управляющие - escape-последовательностью, чтобы в
+// выводе не было сырых байт вроде NUL
+void print_char(std::ostream& out, char c) {
+    out << '\'';
+    switch (c) {
+        case '\0': out << "\\0"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        case '\\': out << "\\\\"; break;
+        case '\'': out << "\\'"; break;
+        default: {
+            auto code = static_cast<unsigned char>(c);
+            if (code >= 0x20 && code != 0x7f) {
+                out << c;
+                break;
+            }
+            const char* digits = "0123456789abcdef";
+            out << "\\x" << digits[code >> 4] << digits[code & 0xf];
+        }
+    }
+    out << '\'';
+}
+
+// регистр константы показывается ее значением
+void print_register(std::ostream& out, const Function& function, Reg r) {
+    if (r < function.constant_base) {
+        out << " r" << r;
+        return;
+    }
+    const auto& value = function.constants[r - function.constant_base];
+    out << " k" << r - function.constant_base << "(";
+    if (value.index() == values::STRING) out << '"' << value.as_string() << '"';
+    else if (value.index() == values::CHAR) print_char(out, value.as_char());
+    else values::print(out, value);
+    out << ")";
+}
+
+}
+
+const OpInfo& opInfo(Op op) {
+    return infos[static_cast<std::size_t>(op)];
+}
+
+void disassemble(const Module& module, std::ostream& out) {
+    for (std::size_t f = 0; f < module.functions.size(); ++f) {
+        const auto& function = module.functions[f];
+        out << "функция " << f << " " << function.name << ": параметров " << function.params
+            << ", регистров " << function.registers << ", константы с r" << function.constant_base;
+        if (function.code.empty()) out << ", без тела";
+        out << '\n';
+        for (std::size_t pc = 0; pc < function.code.size(); ++pc) {
+            const auto& instr = function.code[pc];
+            const auto& info = opInfo(instr.op);
+            out << std::setw(6) << pc << "  " << std::left << std::setw(11) << info.name << std::right;
+            const Operand kinds[] = {info.a, info.b, info.c};
+            const Reg operands[] = {instr.a, instr.b, instr.c};
+            for (int i = 0; i < 3; ++i) {
+                switch (kinds[i]) {
+                    case Operand::_: break;
+                    case Operand::R: print_register(out, function, operands[i]); break;
+                    case Operand::N: out << " " << operands[i]; break;
+                    case Operand::I: out << " " << static_cast<std::int16_t>(operands[i]); break;
+                    case Operand::T: out << " " << type_name(operands[i]); break;
+                    case Operand::F: out << " " << module.functions[operands[i]].name; break;
+                    case Operand::G: out << " g" << instr.wide(); break;
+                    case Operand::J: out << " -> " << static_cast<std::int64_t>(pc) + 1 + instr.jump(); break;
+                    case Operand::M: out << " \"" << module.messages[instr.wide()] << '"'; break;
+                }
+            }
+            out << '\n';
+        }
+    }
+}
@@ -0,0 +1,1038 @@
+#include "bytecode.hpp"
+#include "visitor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error(message);
+}
+
+// номер константы до раскладки кадра; в finish заменяется на constant_base + номер
+constexpr Reg CONSTANT = 0x8000;
+
+// ADD..SHR идут в Op в том же порядке, что в OpKind
+Op binary(OpKind oper) {
+    return static_cast<Op>(static_cast<int>(Op::ADD) + static_cast<int>(oper));
+}
+
+// EQ..GEQ - в JMP_EQ..JMP_GEQ: порядок в Op другой
+Op compare_branch(OpKind oper) {
+    switch (oper) {
+        case OpKind::EQ: return Op::JMP_EQ;
+        case OpKind::NEQ: return Op::JMP_NEQ;
+        case OpKind::LT: return Op::JMP_LT;
+        case OpKind::GT: return Op::JMP_GT;
+        case OpKind::LEQ: return Op::JMP_LEQ;
+        default: return Op::JMP_GEQ;
+    }
+}
+
+bool is_comparison(const ExprNode& node) {
+    if (node.kind != NodeKind::BINARY) return false;
+    auto oper = static_cast<const BinaryExprNode&>(node).oper;
+    return oper >= OpKind::EQ && oper <= OpKind::GEQ;
+}
+
+// шаг ++, --, += и -= небольшим целым литералом - операнд INC_LOCAL
+bool small_step(const ExprNode* node, int sign, std::int16_t& step) {
+    if (!node || node->kind != NodeKind::LITERAL) return false;
+    auto* value = std::get_if<int>(&static_cast<const LiteralExprNode*>(node)->value);
+    if (!value || *value > 0x7FFF || *value < -0x7FFF) return false;
+    step = static_cast<std::int16_t>(sign * *value);
+    return true;
+}
+
+bool is_struct(TypeId type) {
+    return type != types::UNKNOWN && type >= types::STRUCT;
+}
+
+// в цикле с таким кодом куча растет каждую итерацию - нужны MARK и RELEASE
+struct Allocation {
+    const Program& program;
+    bool found = false;
+
+    void operator()(VarDeclNode& node) {
+        if (is_struct(program.type(node.type))) found = true;
+        for (auto& var : node.variables) {
+            if (var.size || (var.init && var.init->kind == NodeKind::ARRAY_INIT)) found = true;
+        }
+    }
+    void operator()(ArrayInitExprNode&) { found = true; }
+    void operator()(CallExprNode& node) {
+        if (is_struct(program.type(program.functions[node.function]->func_type))) found = true;
+    }
+};
+
+// выражение меняет переменные: левый операнд-переменную тогда надо прочитать до него
+struct Writes {
+    bool found = false;
+
+    void operator()(AssignExprNode&) { found = true; }
+    void operator()(PostfixExprNode&) { found = true; }
+    void operator()(UnaryExprNode& node) {
+        if (node.oper == OpKind::INC || node.oper == OpKind::DEC) found = true;
+    }
+};
+
+// регистры кадра: локальные переменные на своих ячейках из Resolver, выше - временные
+// значения выражений, стопкой: выражение оставляет результат в reg, а все временные выше
+// него к концу инструкции свободны. операторы - посетитель для visit, как Resolver; выражения
+// компилируются задачами на явном стеке (stage), каждая продолжается, когда готовы операнды
+class Compiler {
+public:
+    Compiler(const Program& program, Module& module) : program(program), module(module) {}
+
+    void function(const FuncDeclNode& node, Function& out);
+    void constructor(TypeId type, Function& out);
+    void entry(ASTRootNode& root, Function& out);
+
+    void operator()(ReturnStatmNode& node);
+    void operator()(BreakStatmNode& node);
+    void operator()(ContinueStatmNode& node);
+    void operator()(ConditionStatmNode& node);
+    void operator()(ExprStatmNode& node);
+    void operator()(BlockStatmNode& node);
+    void operator()(ForStatmNode& node);
+    void operator()(WhileStatmNode& node);
+    void operator()(InputStatmNode& node);
+    void operator()(OutStatmNode& node);
+    void operator()(SZFStatmNode& node);
+    void operator()(ExitStatmNode& node);
+
+    void operator()(VarDeclNode& node);
+    void operator()(AssertDeclNode& node);
+
+private:
+    enum class Where : std::uint8_t { LOCAL, GLOBAL, FIELD, INDEX };
+
+    // то, куда пишет присваивание: регистр, глобальная или ячейка объекта
+    struct Place {
+        Where where;
+        Reg object = 0;             // LOCAL - сам регистр, FIELD и INDEX - объект
+        Reg index = 0;
+        std::uint32_t number = 0;   // GLOBAL - номер глобальной, FIELD - поля
+    };
+
+    struct Loop {
+        std::vector<std::size_t> breaks;
+        std::vector<std::size_t> continues;
+    };
+
+    // часть выражения: задача ставит в tasks подзадачи для операндов и продолжается со
+    // следующей стадии, когда они готовы. VALUE оставляет значение в reg, OPERANDS - левый
+    // операнд бинарного узла в reg и правый в second, BRANCH - переход в jumped, PLACE - located
+    struct Task {
+        enum Kind : std::uint8_t { VALUE, OPERANDS, BRANCH, PLACE };
+
+        Kind kind;
+        ExprNode* node;
+        std::uint8_t stage = 0;
+        bool used = true;           // VALUE - нужен ли результат, BRANCH - when
+        Reg saved = 0;              // next до узла
+        Reg target = 0;             // регистр результата, левый операнд или первый аргумент
+        Reg value = 0;              // правая часть присваивания
+        std::size_t at = 0;         // переход, который еще не закрыт
+        std::size_t index = 0;      // следующий аргумент или элемент
+    };
+
+    const Program& program;
+    Module& module;
+    Function* fn = nullptr;
+    std::unordered_map<Value, Reg> constants;
+    Reg locals = 0;             // регистры переменных, временные - с него
+    Reg next = 0;               // первый свободный временный
+    Reg top = 0;                // наибольший занятый + 1
+    Reg reg = 0;                // результат последнего выражения
+    std::size_t label = 0;      // последняя цель перехода вперед: инструкции до нее не сливаются
+    std::vector<Loop> loops;
+    std::vector<Task> tasks;
+    Reg second = 0;             // правый операнд после OPERANDS
+    std::size_t jumped = 0;     // переход после BRANCH
+    Place located;              // цель после PLACE
+    std::unordered_map<const ExprNode*, bool> writes;  // changes по узлам
+
+    void begin(Function& out, std::uint32_t frame);
+    void finish();
+
+    Reg expression(ExprNode& node, bool used = true);
+    void run(Task task);
+    void later(Task task, std::uint8_t stage);
+    void then(Task::Kind kind, ExprNode& node, bool used = true);
+    void statement(ASTNode* node);
+    Reg result(StatmNode& node);
+
+    Reg temp();
+    Reg constant(const Value& value);
+    void emit(Op op, Reg a = 0, Reg b = 0, Reg c = 0);
+    void emit_wide(Op op, Reg a, std::uint32_t wide);
+    void move(Reg target, Reg source);
+    std::size_t here() const { return fn->code.size(); }
+    std::size_t jump(Op op, Reg a = 0);
+    void jump_to(Op op, Reg a, std::size_t target);
+    void patch(std::size_t at, std::size_t target);
+    std::size_t branch(ExprNode& condition, bool when);
+    bool changes(ExprNode& root);
+    void increment(Reg local, std::int16_t step);
+
+    void stage(TernaryExprNode& node, Task& task);
+    void stage(BinaryExprNode& node, Task& task);
+    void stage(UnaryExprNode& node, Task& task);
+    void stage(AssignExprNode& node, Task& task);
+    void stage(PostfixExprNode& node, Task& task);
+    void stage(LiteralExprNode& node, Task& task);
+    void stage(IdExprNode& node, Task& task);
+    void stage(MemberAccessExprNode& node, Task& task);
+    void stage(CallExprNode& node, Task& task);
+    void stage(ArrayAccessExprNode& node, Task& task);
+    void stage(ArrayInitExprNode& node, Task& task);
+    void stage_operands(Task& task);
+    void stage_branch(Task& task);
+    void stage_place(Task& task);
+
+    Place place(ExprNode& node);
+    Reg load(const Place& place);
+    void store(const Place& place, Reg value);
+
+    Reg make(TypeId type);
+    void declare(Reg target, TypeId type, const VariableNode& var);
+    void return_default();
+    void loop(ASTNode* init, ExprNode* condition, ExprNode* incr, StatmNode* body, ASTNode& node, bool body_first = false);
+    bool allocates(ASTNode& node) const;
+};
+
+void Compiler::begin(Function& out, std::uint32_t frame) {
+    if (frame >= CONSTANT) fail("слишком много переменных в функции " + out.name);
+    fn = &out;
+    constants.clear();
+    locals = next = top = static_cast<Reg>(frame);
+    label = 0;
+    loops.clear();
+}
+
+// константы ложатся сразу над временными
+void Compiler::finish() {
+    if (top + fn->constants.size() > 0xFFFF) fail("слишком много регистров в функции " + fn->name);
+    fn->constant_base = top;
+    fn->registers = static_cast<Reg>(top + fn->constants.size());
+    auto fix = [this](Operand kind, Reg& operand) {
+        if (kind == Operand::R && (operand & CONSTANT)) operand = fn->constant_base + (operand & ~CONSTANT);
+    };
+    for (auto& instr : fn->code) {
+        const auto& info = opInfo(instr.op);
+        fix(info.a, instr.a);
+        fix(info.b, instr.b);
+        fix(info.c, instr.c);
+    }
+}
+
+void Compiler::function(const FuncDeclNode& node, Function& out) {
+    out.name = symbols::name(node.func_name);
+    out.params = static_cast<Reg>(node.parameters.size());
+    out.result = program.type(node.func_type);
+    if (!node.body) return;
+    begin(out, node.frame_size);
+
+    // аргументы приходят как есть: скаляры приводятся к типу параметра, структуры копируются
+    for (Reg i = 0; i < out.params; ++i) {
+        auto type = program.type(node.parameters[i].first);
+        if (is_struct(type)) {
+            Reg copy = make(type);
+            emit(Op::STORE, copy, i);
+            emit(Op::MOVE, i, copy);
+            next = locals;
+        } else {
+            emit(Op::CAST, i, i, static_cast<Reg>(type));
+        }
+    }
+    for (auto* statement : node.body->statements) this->statement(statement);
+    return_default();
+    finish();
+}
+
+// конструктор структуры: поля по умолчанию со своими инициализаторами, по порядку
+void Compiler::constructor(TypeId type, Function& out) {
+    const auto& layout = program.structs[type - types::STRUCT];
+    out.name = std::string(symbols::name(layout.decl->name)) + ".new";
+    out.result = type;
+    out.constructor = true;
+    begin(out, 0);
+    if (layout.fields.size() > 0xFFFF) fail("слишком много полей в структуре " + out.name);
+    Reg object = temp();
+    emit(Op::NEW_OBJECT, object, static_cast<Reg>(layout.fields.size()));
+    for (std::size_t i = 0; i < layout.fields.size(); ++i) {
+        Reg field = temp();
+        declare(field, layout.field_types[i], *layout.fields[i]);
+        emit(Op::SET_FIELD, object, static_cast<Reg>(i), field);
+        next = object + 1;
+    }
+    emit(Op::RET, object);
+    finish();
+}
+
+// точка входа: глобальные переменные и ассерты по порядку, затем main
+void Compiler::entry(ASTRootNode& root, Function& out) {
+    out.name = "<init>";
+    out.result = types::UNKNOWN;
+    begin(out, 0);
+    for (auto* statement : root.statements) {
+        if (statement) visit(*statement, *this);
+        next = locals;
+    }
+    Reg base = temp();
+    emit(Op::CALL, base, static_cast<Reg>(program.main), 0);
+    emit(Op::RET, base);
+    finish();
+}
+
+Reg Compiler::expression(ExprNode& node, bool used) {
+    run({Task::VALUE, &node, 0, used});
+    return reg;
+}
+
+// задачи выполняются, пока tasks не вернется к тому, что было до run
+void Compiler::run(Task task) {
+    const std::size_t bottom = tasks.size();
+    tasks.push_back(task);
+    while (tasks.size() > bottom) {
+        Task current = tasks.back();
+        tasks.pop_back();
+        switch (current.kind) {
+            case Task::VALUE:
+                visit(*current.node, [this, &current](auto& node) {
+                    if constexpr (std::is_base_of_v<ExprNode, std::remove_reference_t<decltype(node)>>)
+                        stage(node, current);
+                });
+                break;
+            case Task::OPERANDS: stage_operands(current); break;
+            case Task::BRANCH: stage_branch(current); break;
+            case Task::PLACE: stage_place(current); break;
+        }
+    }
+}
+
+// задача продолжится со стадии stage после тех, что поставлены за ней
+void Compiler::later(Task task, std::uint8_t stage) {
+    task.stage = stage;
+    tasks.push_back(task);
+}
+
+void Compiler::then(Task::Kind kind, ExprNode& node, bool used) {
+    tasks.push_back({kind, &node, 0, used});
+}
+
+// временные регистры инструкции освобождаются после нее
+void Compiler::statement(ASTNode* node) {
+    if (!node) return;
+    Reg saved = next;
+    if (node->kind <= NodeKind::ARRAY_INIT) expression(static_cast<ExprNode&>(*node), false);
+    else visit(*node, *this);
+    next = saved;
+}
+
+// значение после return и print: выражение или sizeof
+Reg Compiler::result(StatmNode& node) {
+    if (node.kind == NodeKind::SIZEOF) {
+        (*this)(static_cast<SZFStatmNode&>(node));
+        return reg;
+    }
+    if (node.kind == NodeKind::EXPR_STATM) {
+        auto* expr = static_cast<ExprStatmNode&>(node).expr;
+        if (expr && expr->kind != NodeKind::VAR_DECL) return expression(*static_cast<ExprNode*>(expr));
+    }
+    fail("ожидалось выражение");
+}
+
+Reg Compiler::temp() {
+    if (next + 1 >= CONSTANT) fail("слишком много регистров в функции " + fn->name);
+    Reg r = next++;
+    top = std::max(top, next);
+    return r;
+}
+
+Reg Compiler::constant(const Value& value) {
+    auto [it, added] = constants.try_emplace(value, static_cast<Reg>(CONSTANT | fn->constants.size()));
+    if (added) {
+        if (fn->constants.size() == CONSTANT) fail("слишком много констант в функции " + fn->name);
+        fn->constants.push_back(value);
+    }
+    return it->second;
+}
+
+void Compiler::emit(Op op, Reg a, Reg b, Reg c) {
+    fn->code.push_back({op, a, b, c});
+}
+
+void Compiler::emit_wide(Op op, Reg a, std::uint32_t wide) {
+    Instr instr{op, a};
+    instr.set_wide(wide);
+    fn->code.push_back(instr);
+}
+
+void Compiler::move(Reg target, Reg source) {
+    if (target != source) emit(Op::MOVE, target, source);
+}
+
+// переход вперед, цель - в patch
+std::size_t Compiler::jump(Op op, Reg a) {
+    emit(op, a);
+    return here() - 1;
+}
+
+void Compiler::jump_to(Op op, Reg a, std::size_t target) {
+    patch(jump(op, a), target);
+}
+
+// смещение от инструкции после перехода
+void Compiler::patch(std::size_t at, std::size_t target) {
+    auto offset = static_cast<std::int64_t>(target) - static_cast<std::int64_t>(at + 1);
+    fn->code[at].set_wide(static_cast<std::uint32_t>(static_cast<std::int32_t>(offset)));
+    label = std::max(label, target);
+}
+
+std::size_t Compiler::branch(ExprNode& condition, bool when) {
+    run({Task::BRANCH, &condition, 0, when});
+    return jumped;
+}
+
+// меняет ли выражение переменные. ответ запоминается для всего поддерева, иначе в цепочке
+// a + (a + (a + ...)) правая часть обходилась бы заново на каждом уровне
+bool Compiler::changes(ExprNode& root) {
+    if (auto it = writes.find(&root); it != writes.end()) return it->second;
+    std::vector<char> found;
+    post_order(root, [this, &found](auto& node, std::size_t operands) {
+        Writes self;
+        if constexpr (std::is_invocable_v<Writes&, decltype(node)>) self(node);
+        auto first = found.end() - static_cast<std::ptrdiff_t>(operands);
+        bool result = self.found || std::find(first, found.end(), true) != found.end();
+        found.erase(first, found.end());
+        found.push_back(result);
+        writes[&node] = result;
+    });
+    return found.back();
+}
+
+void Compiler::increment(Reg local, std::int16_t step) {
+    emit(Op::INC_LOCAL, local, static_cast<Reg>(step));
+}
+
+Compiler::Place Compiler::place(ExprNode& node) {
+    run({Task::PLACE, &node});
+    return located;
+}
+
+Reg Compiler::load(const Place& place) {
+    if (place.where == Where::LOCAL) return place.object;
+    Reg r = temp();
+    switch (place.where) {
+        case Where::GLOBAL: emit_wide(Op::GET_GLOBAL, r, place.number); break;
+        case Where::FIELD: emit(Op::GET_FIELD, r, place.object, static_cast<Reg>(place.number)); break;
+        default: emit(Op::GET_INDEX, r, place.object, place.index); break;
+    }
+    return r;
+}
+
+void Compiler::store(const Place& place, Reg value) {
+    switch (place.where) {
+        case Where::LOCAL: {
+            // ADD во временный и STORE из него - одна ADD_STORE, если на STORE никто не переходит
+            if (!fn->code.empty() && label != here() && value >= locals && !(value & CONSTANT)) {
+                auto& last = fn->code.back();
+                if (last.op == Op::ADD && last.a == value) {
+                    last = {Op::ADD_STORE, place.object, last.b, last.c};
+                    break;
+                }
+            }
+            emit(Op::STORE, place.object, value);
+            break;
+        }
+        case Where::GLOBAL: emit_wide(Op::SET_GLOBAL, value, place.number); break;
+        case Where::FIELD: emit(Op::SET_FIELD, place.object, static_cast<Reg>(place.number), value); break;
+        case Where::INDEX: emit(Op::SET_INDEX, place.object, place.index, value); break;
+    }
+}
+
+// значение по умолчанию: скаляр - константа, структура - вызов ее конструктора
+Reg Compiler::make(TypeId type) {
+    switch (type) {
+        case types::INT: return constant(0);
+        case types::FLOAT: return constant(0.0);
+        case types::CHAR: return constant('\0');
+        case types::BOOL: return constant(false);
+        case types::VOID: fail("значение типа void");
+        default: break;
+    }
+    Reg base = temp();
+    auto function = module.constructors[type - types::STRUCT];
+    emit(Op::CALL, base, static_cast<Reg>(function), 0);
+    return base;
+}
+
+// как EvalVisitor::declare: значение по умолчанию, затем инициализатор; target - новый регистр
+// или ячейка переменной, до этого в нем ничего нет
+void Compiler::declare(Reg target, TypeId type, const VariableNode& var) {
+    auto* list = var.init && var.init->kind == NodeKind::ARRAY_INIT ?
+        static_cast<ArrayInitExprNode*>(var.init) : nullptr;
+    if (!var.size && !list) {
+        if (is_struct(type)) {
+            move(target, make(type));
+            if (var.init) emit(Op::STORE, target, expression(*var.init));
+        } else if (var.init) {
+            emit(Op::CAST, target, expression(*var.init), static_cast<Reg>(type));
+        } else {
+            emit(Op::MOVE, target, make(type));
+        }
+        return;
+    }
+
+    Reg count = var.size ? expression(*var.size) : constant(static_cast<int>(list->elements.size()));
+    if (!is_struct(type)) {
+        emit(Op::NEW_ARRAY, target, count, static_cast<Reg>(type));
+    } else {
+        // элементы-структуры: свой объект на каждый, в цикле по индексу
+        emit(Op::NEW_ARRAY, target, count, NO_TYPE);
+        Reg index = temp();
+        emit(Op::MOVE, index, constant(0));
+        auto enter = jump(Op::JMP);
+        auto body = here();
+        Reg saved = next;
+        emit(Op::SET_INDEX, target, index, make(type));
+        increment(index, 1);
+        next = saved;
+        patch(enter, here());
+        emit(Op::JMP_LT, index, count, 0);
+        jump_to(Op::JMP, 0, body);
+    }
+    if (list) {
+        for (std::size_t i = 0; i < list->elements.size(); ++i) {
+            Reg saved = next;
+            Reg element = expression(*list->elements[i]);
+            emit(Op::SET_INDEX, target, constant(static_cast<int>(i)), element);
+            next = saved;
+        }
+    } else if (var.init) {
+        emit(Op::STORE, target, expression(*var.init));
+    }
+}
+
+// return без значения и конец тела: у не-void функции - значение по умолчанию ее типа
+void Compiler::return_default() {
+    if (fn->result == types::VOID) emit(Op::RET_VOID);
+    else emit(Op::RET, make(fn->result));
+}
+
+bool Compiler::allocates(ASTNode& node) const {
+    Allocation allocation{program};
+    walk(node, allocation);
+    return allocation.found;
+}
+
+void Compiler::stage(TernaryExprNode& node, Task& task) {
+    switch (task.stage) {
+        case 0:
+            task.target = temp();
+            later(task, 1);
+            then(Task::BRANCH, *node.condition, false);
+            return;
+        case 1:
+            task.at = jumped;
+            later(task, 2);
+            then(Task::VALUE, *node.true_expr);
+            return;
+        case 2: {
+            move(task.target, reg);
+            next = task.target + 1;
+            auto to_end = jump(Op::JMP);
+            patch(task.at, here());
+            task.at = to_end;
+            later(task, 3);
+            then(Task::VALUE, *node.false_expr);
+            return;
+        }
+        default:
+            move(task.target, reg);
+            next = task.target + 1;
+            patch(task.at, here());
+            reg = task.target;
+    }
+}
+
+void Compiler::stage(BinaryExprNode& node, Task& task) {
+    switch (node.oper) {
+        case OpKind::AND:
+        case OpKind::OR:
+            if (task.stage == 0) {
+                task.target = temp();
+                later(task, 1);
+                then(Task::VALUE, *node.left);
+            } else if (task.stage == 1) {
+                emit(Op::TEST, task.target, reg);
+                task.at = jump(node.oper == OpKind::AND ? Op::JMP_IFNOT : Op::JMP_IF, task.target);
+                next = task.target + 1;
+                later(task, 2);
+                then(Task::VALUE, *node.right);
+            } else {
+                emit(Op::TEST, task.target, reg);
+                next = task.target + 1;
+                patch(task.at, here());
+                reg = task.target;
+            }
+            return;
+        case OpKind::COMMA:
+            if (task.stage == 0) {
+                task.saved = next;
+                later(task, 1);
+                then(Task::VALUE, *node.left, false);
+            } else {
+                next = task.saved;
+                then(Task::VALUE, *node.right, task.used);
+            }
+            return;
+        default:
+            if (task.stage == 0) {
+                task.saved = next;
+                later(task, 1);
+                then(Task::OPERANDS, node);
+                return;
+            }
+            Reg left = reg;
+            next = task.saved;
+            reg = temp();
+            emit(binary(node.oper), reg, left, second);
+    }
+}
+
+void Compiler::stage(UnaryExprNode& node, Task& task) {
+    Op op;
+    switch (node.oper) {
+        case OpKind::INC:
+        case OpKind::DEC: {
+            if (task.stage == 0) {
+                later(task, 1);
+                then(Task::PLACE, *node.operand);
+                return;
+            }
+            auto target = located;
+            if (target.where == Where::LOCAL) {
+                increment(target.object, node.oper == OpKind::INC ? 1 : -1);
+                reg = target.object;
+                return;
+            }
+            Reg updated = temp();
+            emit(node.oper == OpKind::INC ? Op::ADD : Op::SUB, updated, load(target), constant(1));
+            store(target, updated);
+            reg = task.used ? load(target) : updated;
+            return;
+        }
+        case OpKind::ADD: op = Op::PLUS; break;
+        case OpKind::SUB: op = Op::NEG; break;
+        case OpKind::NOT: op = Op::NOT; break;
+        case OpKind::BIT_NOT: op = Op::BIT_NOT; break;
+        default: fail("неизвестный унарный оператор '" + std::string(opSpelling(node.oper)) + "'");
+    }
+    if (task.stage == 0) {
+        task.saved = next;
+        later(task, 1);
+        then(Task::VALUE, *node.operand);
+        return;
+    }
+    Reg operand = reg;
+    next = task.saved;
+    reg = temp();
+    emit(op, reg, operand);
+}
+
+// правая часть считается первой, составное присваивание читает цель уже после нее
+void Compiler::stage(AssignExprNode& node, Task& task) {
+    switch (task.stage) {
+        case 0: {
+            std::int16_t step;
+            if ((node.oper == OpKind::ADD_ASSIGN || node.oper == OpKind::SUB_ASSIGN) && node.left->kind == NodeKind::ID &&
+                static_cast<IdExprNode*>(node.left)->depth &&
+                small_step(node.right, node.oper == OpKind::ADD_ASSIGN ? 1 : -1, step)) {
+                reg = static_cast<Reg>(static_cast<IdExprNode*>(node.left)->slot);
+                increment(reg, step);
+                return;
+            }
+            later(task, 1);
+            then(Task::VALUE, *node.right);
+            return;
+        }
+        case 1:
+            task.value = reg;
+            later(task, 2);
+            then(Task::PLACE, *node.left);
+            return;
+        default:
+            break;
+    }
+    Reg value = task.value;
+    auto target = located;
+    if (node.oper != OpKind::ASSIGN) {
+        // ADD_ASSIGN..MOD_ASSIGN идут в том же порядке, что ADD..MOD
+        auto oper = static_cast<OpKind>(static_cast<int>(node.oper) - static_cast<int>(OpKind::ADD_ASSIGN));
+        Reg current = load(target);
+        Reg combined = temp();
+        emit(binary(oper), combined, current, value);
+        value = combined;
+    }
+    store(target, value);
+    reg = task.used ? load(target) : value;
+}
+
+void Compiler::stage(PostfixExprNode& node, Task& task) {
+    if (task.stage == 0) {
+        later(task, 1);
+        then(Task::PLACE, *node.operand);
+        return;
+    }
+    auto target = located;
+    Reg current = load(target);
+    Reg old = current;
+    if (target.where == Where::LOCAL) {
+        if (task.used) {
+            old = temp();
+            emit(Op::MOVE, old, current);
+        }
+        increment(current, node.oper == OpKind::INC ? 1 : -1);
+        reg = old;
+        return;
+    }
+    Reg updated = temp();
+    emit(node.oper == OpKind::INC ? Op::ADD : Op::SUB, updated, current, constant(1));
+    store(target, updated);
+    reg = old;
+}
+
+void Compiler::stage(LiteralExprNode& node, Task&) {
+    reg = constant(values::literal(node.value));
+}
+
+void Compiler::stage(IdExprNode& node, Task&) {
+    if (node.depth) {
+        reg = static_cast<Reg>(node.slot);
+        return;
+    }
+    reg = temp();
+    emit_wide(Op::GET_GLOBAL, reg, node.slot);
+}
+
+void Compiler::stage(MemberAccessExprNode& node, Task& task) {
+    if (task.stage == 0) {
+        task.saved = next;
+        later(task, 1);
+        then(Task::VALUE, *node.object);
+        return;
+    }
+    Reg object = reg;
+    next = task.saved;
+    reg = temp();
+    emit(Op::GET_FIELD, reg, object, static_cast<Reg>(node.field));
+}
+
+// аргументы - подряд в верхних временных, результат - на месте первого
+void Compiler::stage(CallExprNode& node, Task& task) {
+    if (task.stage == 0) {
+        task.target = next;
+    } else {
+        Reg argument = reg;
+        next = static_cast<Reg>(task.target + task.index);
+        move(temp(), argument);
+        ++task.index;
+    }
+    if (task.index < node.arguments.size()) {
+        later(task, 1);
+        then(Task::VALUE, *node.arguments[task.index]);
+        return;
+    }
+    Reg base = task.target;
+    next = base;
+    reg = temp();
+    emit(Op::CALL, base, static_cast<Reg>(node.function), static_cast<Reg>(node.arguments.size()));
+}
+
+void Compiler::stage(ArrayAccessExprNode& node, Task& task) {
+    switch (task.stage) {
+        case 0:
+            task.saved = next;
+            later(task, 1);
+            then(Task::VALUE, *node.array);
+            return;
+        case 1:
+            task.target = reg;
+            later(task, 2);
+            then(Task::VALUE, *node.index);
+            return;
+        default: {
+            Reg index = reg;
+            next = task.saved;
+            reg = temp();
+            emit(Op::GET_INDEX, reg, task.target, index);
+        }
+    }
+}
+
+// список вне объявления - временный массив, присваивание скопирует его в цель
+void Compiler::stage(ArrayInitExprNode& node, Task& task) {
+    if (task.stage == 0) {
+        task.target = temp();
+        emit(Op::NEW_ARRAY, task.target, constant(static_cast<int>(node.elements.size())), NO_TYPE);
+    } else {
+        emit(Op::SET_INDEX, task.target, constant(static_cast<int>(task.index)), reg);
+        next = task.target + 1;
+        ++task.index;
+    }
+    if (task.index < node.elements.size()) {
+        later(task, 1);
+        then(Task::VALUE, *node.elements[task.index]);
+        return;
+    }
+    reg = task.target;
+}
+
+// операнды бинарного оператора. переменная читается инструкцией, а не при обходе: если правая
+// часть ее меняет, прежнее значение надо сохранить, как делает дерево
+void Compiler::stage_operands(Task& task) {
+    auto& node = static_cast<BinaryExprNode&>(*task.node);
+    switch (task.stage) {
+        case 0:
+            later(task, 1);
+            then(Task::VALUE, *node.left);
+            return;
+        case 1:
+            task.target = reg;
+            if (task.target < locals && changes(*node.right)) {
+                Reg copy = temp();
+                emit(Op::MOVE, copy, task.target);
+                task.target = copy;
+            }
+            later(task, 2);
+            then(Task::VALUE, *node.right);
+            return;
+        default:
+            second = reg;
+            reg = task.target;
+    }
+}
+
+// переход, если условие равно when. сравнение сливается с переходом: JMP_LT и т.п. сами
+// выполняют или пропускают следующий за ними JMP - одна выборка инструкции вместо двух
+void Compiler::stage_branch(Task& task) {
+    const bool when = task.used;
+    switch (task.stage) {
+        case 0:
+            task.saved = next;
+            if (is_comparison(*task.node)) {
+                later(task, 1);
+                then(Task::OPERANDS, *task.node);
+            } else {
+                later(task, 2);
+                then(Task::VALUE, *task.node);
+            }
+            return;
+        case 1:
+            emit(compare_branch(static_cast<BinaryExprNode&>(*task.node).oper), reg, second, !when);
+            jumped = jump(Op::JMP);
+            break;
+        default:
+            jumped = jump(when ? Op::JMP_IF : Op::JMP_IFNOT, reg);
+            break;
+    }
+    next = task.saved;
+}
+
+// объект и индекс считаются здесь, ячейка читается и пишется в load и store
+void Compiler::stage_place(Task& task) {
+    switch (task.node->kind) {
+        case NodeKind::ID: {
+            auto& id = static_cast<IdExprNode&>(*task.node);
+            if (id.depth) located = {Where::LOCAL, static_cast<Reg>(id.slot)};
+            else located = {Where::GLOBAL, 0, 0, id.slot};
+            return;
+        }
+        case NodeKind::MEMBER_ACCESS: {
+            auto& access = static_cast<MemberAccessExprNode&>(*task.node);
+            if (task.stage == 0) {
+                later(task, 1);
+                then(Task::VALUE, *access.object);
+            } else {
+                located = {Where::FIELD, reg, 0, access.field};
+            }
+            return;
+        }
+        case NodeKind::ARRAY_ACCESS: {
+            auto& access = static_cast<ArrayAccessExprNode&>(*task.node);
+            if (task.stage == 0) {
+                later(task, 1);
+                then(Task::VALUE, *access.array);
+            } else if (task.stage == 1) {
+                task.target = reg;
+                later(task, 2);
+                then(Task::VALUE, *access.index);
+            } else {
+                located = {Where::INDEX, task.target, reg};
+            }
+            return;
+        }
+        default:
+            fail("ожидалась переменная, элемент массива или поле");
+    }
+}
+
+void Compiler::operator()(ReturnStatmNode& node) {
+    if (node.expr) emit(Op::RET, result(*node.expr));
+    else return_default();
+}
+
+void Compiler::operator()(BreakStatmNode&) {
+    loops.back().breaks.push_back(jump(Op::JMP));
+}
+
+void Compiler::operator()(ContinueStatmNode&) {
+    loops.back().continues.push_back(jump(Op::JMP));
+}
+
+void Compiler::operator()(ConditionStatmNode& node) {
+    auto to_else = branch(*node.condition, false);
+    statement(node.then_statm);
+    if (!node.else_statm) {
+        patch(to_else, here());
+        return;
+    }
+    auto to_end = jump(Op::JMP);
+    patch(to_else, here());
+    statement(node.else_statm);
+    patch(to_end, here());
+}
+
+void Compiler::operator()(ExprStatmNode& node) {
+    if (!node.expr) return;
+    if (node.expr->kind == NodeKind::VAR_DECL) visit(*node.expr, *this);
+    else expression(*static_cast<ExprNode*>(node.expr), false);
+}
+
+void Compiler::operator()(BlockStatmNode& node) {
+    for (auto* statement : node.statements) this->statement(statement);
+}
+
+void Compiler::operator()(ForStatmNode& node) {
+    loop(node.init, node.condition, node.incr, node.body, node);
+}
+
+void Compiler::operator()(WhileStatmNode& node) {
+    loop(nullptr, node.condition, nullptr, node.body, node, node.do_while);
+}
+
+// условие внизу: за итерацию один условный переход, а вход в цикл прыгает на него -
+// кроме do-while (body_first). если цикл создает объекты в куче, созданное за итерацию
+// освобождается перед следующей и при выходе, как в EvalVisitor
+void Compiler::loop(ASTNode* init, ExprNode* condition, ExprNode* incr, StatmNode* body, ASTNode& node, bool body_first) {
+    statement(init);
+    Reg mark = 0;
+    bool release = allocates(node);
+    if (release) {
+        mark = temp();
+        emit(Op::MARK, mark);
+    }
+    std::size_t enter = body_first ? 0 : jump(Op::JMP);
+    loops.emplace_back();
+    auto start = here();
+    statement(body);
+    auto next_iteration = here();
+    if (incr) {
+        Reg saved = next;
+        expression(*incr, false);
+        next = saved;
+    }
+    if (release) emit(Op::RELEASE, mark);
+    if (!body_first) patch(enter, here());
+    if (condition) {
+        patch(branch(*condition, true), start);
+    } else {
+        jump_to(Op::JMP, 0, start);
+    }
+    auto exit = here();
+    if (release) emit(Op::RELEASE, mark);
+    for (auto at : loops.back().breaks) patch(at, exit);
+    for (auto at : loops.back().continues) patch(at, next_iteration);
+    loops.pop_back();
+}
+
+void Compiler::operator()(InputStatmNode& node) {
+    if (!node.expr) return;
+    auto target = place(*static_cast<ExprNode*>(static_cast<ExprStatmNode*>(node.expr)->expr));
+    Reg value = load(target);
+    emit(Op::READ, value);
+    if (target.where != Where::LOCAL) store(target, value);
+}
+
+void Compiler::operator()(OutStatmNode& node) {
+    if (node.expr) emit(Op::PRINT, result(*node.expr));
+    else emit(Op::NEWLINE);
+}
+
+void Compiler::operator()(SZFStatmNode& node) {
+    if (!node.expr) {
+        reg = constant(0);
+        return;
+    }
+    Reg saved = next;
+    Reg value = expression(*node.expr);
+    next = saved;
+    reg = temp();
+    emit(Op::SIZEOF, reg, value);
+}
+
+void Compiler::operator()(ExitStatmNode& node) {
+    emit(Op::EXIT, expression(*node.expr));
+}
+
+// глобальная собирается во временном регистре и один раз пишется на свое место
+void Compiler::operator()(VarDeclNode& node) {
+    auto type = program.type(node.type);
+    for (auto& var : node.variables) {
+        Reg saved = next;
+        if (var.depth) {
+            declare(static_cast<Reg>(var.slot), type, var);
+        } else {
+            Reg value = temp();
+            declare(value, type, var);
+            emit_wide(Op::SET_GLOBAL, value, var.slot);
+        }
+        next = saved;
+    }
+}
+
+void Compiler::operator()(AssertDeclNode& node) {
+    emit_wide(Op::ASSERT, expression(*node.expr), static_cast<std::uint32_t>(module.messages.size()));
+    module.messages.push_back(node.message);
+}
+
+}
+
+Module compile(const Program& program, ASTRootNode& root) {
+    if (program.main == UNRESOLVED) fail("нет функции main");
+    if (!program.functions[program.main]->parameters.empty()) fail("main не принимает параметров");
+    // номер функции - операнд CALL
+    if (program.functions.size() + program.structs.size() + 1 > 0xFFFF) fail("слишком много функций");
+
+    Module module;
+    module.globals = program.globals;
+    module.functions.resize(program.functions.size() + program.structs.size() + 1);
+    for (std::size_t i = 0; i < program.structs.size(); ++i)
+        module.constructors.push_back(static_cast<std::uint32_t>(program.functions.size() + i));
+    module.entry = static_cast<std::uint32_t>(module.functions.size() - 1);
+
+    Compiler compiler(program, module);
+    for (std::size_t i = 0; i < program.functions.size(); ++i)
+        compiler.function(*program.functions[i], module.functions[i]);
+    for (std::size_t i = 0; i < program.structs.size(); ++i)
+        compiler.constructor(types::STRUCT + static_cast<TypeId>(i), module.functions[module.constructors[i]]);
+    compiler.entry(root, module.functions[module.entry]);
+    return module;
+}
@@ -0,0 +1,642 @@
+#include "eval.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <pthread.h>
+
+namespace {
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error(message);
+}
+
+std::string quoted(Symbol name) {
+    return "'" + std::string(symbols::name(name)) + "'";
+}
+
+using values::arithmetic;
+using values::assign;
+using values::to_int;
+using values::to_object;
+using values::truth;
+
+OpKind step(OpKind oper) {
+    return oper == OpKind::INC ? OpKind::ADD : OpKind::SUB;
+}
+
+// стек вызовов растет вниз: глубину рекурсии дает адрес кадра
+std::uintptr_t frame_address() {
+    return reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0));
+}
+
+// нижний край стека вызовов текущего потока, 0 - не удалось узнать
+std::uintptr_t stack_low() {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return 0;
+    void* low = nullptr;
+    std::size_t size = 0;
+    if (pthread_attr_getstack(&attr, &low, &size) != 0) low = nullptr;
+    pthread_attr_destroy(&attr);
+    return reinterpret_cast<std::uintptr_t>(low);
+}
+
+}
+
+EvalVisitor::EvalVisitor(const Program& program, std::istream& in, std::ostream& out) :
+    program(program), in(in), out(out), stack(std::make_unique<Value[]>(STACK_SLOTS)) {}
+
+int EvalVisitor::run(ASTRootNode& root) {
+    if (program.main == UNRESOLVED) fail("нет функции main");
+    const auto& main = *program.functions[program.main];
+    if (!main.parameters.empty()) fail("main не принимает параметров");
+    if (program.globals > STACK_SLOTS) fail("переполнение стека");
+
+    base = 0;
+    top = program.globals;
+    const std::uintptr_t frame = frame_address();
+    const std::uintptr_t low = stack_low();
+    bottom = low ? low + NATIVE_RESERVE : frame - NATIVE_STACK - NATIVE_RESERVE;
+    limit = std::max(frame - NATIVE_STACK, bottom);
+    flow = Flow::NEXT;
+    int code = 0;
+    try {
+        root.accept(*this);
+        auto result = call(main, {});
+        code = result.index() == values::NOTHING ? 0 : to_int(result);
+    } catch (const Exit& exit) {
+        code = exit.code;
+    }
+    out.flush();
+    return code;
+}
+
+// глубина рекурсии - одно сравнение адреса кадра, без счетчика
+Value EvalVisitor::eval(ExprNode& node) {
+    if (frame_address() < limit) return eval_deep(node);
+    node.accept(*this);
+    return std::move(value);
+}
+
+// то же, что visit(...) выражений, но явным стеком: узел - задача, которая сначала ставит в
+// очередь свои операнды, а потом продолжается со следующей стадии и забирает их значения с
+// верха results. вызовы функций внутри по-прежнему идут через invoke
+Value EvalVisitor::eval_deep(ExprNode& root) {
+    struct Task {
+        ExprNode* node;
+        std::uint32_t stage;
+        std::size_t mark;       // вызов: heap.mark() до аргументов
+    };
+    std::vector<Task> tasks{{&root, 0, 0}};
+    std::vector<Value> results;
+    auto later = [&tasks](const Task& task) { tasks.push_back({task.node, task.stage + 1, task.mark}); };
+    // операнды выполняются в порядке аргументов
+    auto operands = [&tasks](auto... nodes) {
+        ExprNode* order[] = {nodes...};
+        for (std::size_t i = sizeof...(nodes); i-- > 0;) tasks.push_back({order[i], 0, 0});
+    };
+    auto list = [&tasks](const auto& nodes) {
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) tasks.push_back({*it, 0, 0});
+    };
+    // объект поля или массив и индекс элемента - то, что считает place
+    auto target = [&operands](ExprNode& node) -> std::size_t {
+        if (node.kind == NodeKind::MEMBER_ACCESS) {
+            operands(static_cast<MemberAccessExprNode&>(node).object);
+            return 1;
+        }
+        if (node.kind == NodeKind::ARRAY_ACCESS) {
+            auto& access = static_cast<ArrayAccessExprNode&>(node);
+            operands(access.array, access.index);
+            return 2;
+        }
+        return 0;
+    };
+    auto count = [](ExprNode& node) -> std::size_t {
+        return node.kind == NodeKind::MEMBER_ACCESS ? 1 : node.kind == NodeKind::ARRAY_ACCESS ? 2 : 0;
+    };
+    auto pop = [&results] {
+        Value result = std::move(results.back());
+        results.pop_back();
+        return result;
+    };
+    // ячейка цели по ее операндам на верху results, операнды снимаются
+    auto located = [&](ExprNode& node) -> Value& {
+        std::size_t n = count(node);
+        Value& cell = locate(node, results.data() + results.size() - n);
+        results.resize(results.size() - n);
+        return cell;
+    };
+
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        ExprNode& node = *task.node;
+        switch (node.kind) {
+            case NodeKind::TERNARY: {
+                auto& ternary = static_cast<TernaryExprNode&>(node);
+                if (task.stage == 0) {
+                    later(task);
+                    operands(ternary.condition);
+                } else {
+                    operands(truth(pop()) ? ternary.true_expr : ternary.false_expr);
+                }
+                break;
+            }
+            case NodeKind::BINARY: {
+                auto& binary = static_cast<BinaryExprNode&>(node);
+                bool logical = binary.oper == OpKind::AND || binary.oper == OpKind::OR;
+                if (task.stage == 0) {
+                    later(task);
+                    if (logical) operands(binary.left);
+                    else operands(binary.left, binary.right);
+                } else if (logical) {
+                    bool decisive = binary.oper == OpKind::OR;
+                    bool result = truth(pop());
+                    if (task.stage == 1 && result != decisive) {
+                        later(task);
+                        operands(binary.right);
+                    } else {
+                        results.push_back(result);
+                    }
+                } else {
+                    Value right = pop();
+                    Value left = pop();
+                    results.push_back(binary.oper == OpKind::COMMA ? right : arithmetic(binary.oper, left, right));
+                }
+                break;
+            }
+            case NodeKind::UNARY: {
+                auto& unary = static_cast<UnaryExprNode&>(node);
+                bool changes = unary.oper == OpKind::INC || unary.oper == OpKind::DEC;
+                if (task.stage == 0) {
+                    later(task);
+                    if (changes) target(*unary.operand);
+                    else operands(unary.operand);
+                } else if (changes) {
+                    Value& cell = located(*unary.operand);
+                    assign(cell, arithmetic(step(unary.oper), cell, 1));
+                    results.push_back(cell);
+                } else {
+                    results.push_back(values::unary(unary.oper, pop()));
+                }
+                break;
+            }
+            case NodeKind::ASSIGN: {
+                auto& assignment = static_cast<AssignExprNode&>(node);
+                if (task.stage == 0) {
+                    later(task);
+                    target(*assignment.left);
+                    operands(assignment.right);
+                    break;
+                }
+                Value& cell = located(*assignment.left);
+                Value right = pop();
+                if (assignment.oper != OpKind::ASSIGN) {
+                    auto oper = static_cast<OpKind>(static_cast<int>(assignment.oper) - static_cast<int>(OpKind::ADD_ASSIGN));
+                    right = arithmetic(oper, cell, right);
+                }
+                assign(cell, right);
+                results.push_back(cell);
+                break;
+            }
+            case NodeKind::POSTFIX: {
+                auto& postfix = static_cast<PostfixExprNode&>(node);
+                if (task.stage == 0) {
+                    later(task);
+                    target(*postfix.operand);
+                    break;
+                }
+                Value& cell = located(*postfix.operand);
+                results.push_back(cell);
+                assign(cell, arithmetic(step(postfix.oper), cell, 1));
+                break;
+            }
+            case NodeKind::LITERAL:
+                results.push_back(values::literal(static_cast<LiteralExprNode&>(node).value));
+                break;
+            case NodeKind::ID: {
+                auto& id = static_cast<IdExprNode&>(node);
+                results.push_back(slot(id.depth, id.slot));
+                break;
+            }
+            case NodeKind::MEMBER_ACCESS:
+            case NodeKind::ARRAY_ACCESS:
+                if (task.stage == 0) {
+                    later(task);
+                    target(node);
+                } else {
+                    Value element = located(node);
+                    results.push_back(element);
+                }
+                break;
+            case NodeKind::CALL: {
+                auto& call = static_cast<CallExprNode&>(node);
+                const auto& func = *program.functions[call.function];
+                if (task.stage == 0) {
+                    enter(func);
+                    task.mark = heap.mark();
+                    later(task);
+                    list(call.arguments);
+                    break;
+                }
+                const std::size_t frame = top;
+                const Value* arguments = results.data() + results.size() - call.arguments.size();
+                for (std::size_t i = 0; i < call.arguments.size(); ++i) bind(func, frame, i, arguments[i]);
+                results.resize(results.size() - call.arguments.size());
+                results.push_back(invoke(func, frame, task.mark));
+                break;
+            }
+            case NodeKind::ARRAY_INIT: {
+                auto& init = static_cast<ArrayInitExprNode&>(node);
+                if (task.stage == 0) {
+                    results.push_back(heap.allocate(init.elements.size()));
+                    later(task);
+                    list(init.elements);
+                    break;
+                }
+                const Value* elements = results.data() + results.size() - init.elements.size();
+                auto* array = to_object(elements[-1]);
+                for (std::size_t i = 0; i < init.elements.size(); ++i) array->slots[i] = elements[i];
+                results.resize(results.size() - init.elements.size());
+                break;
+            }
+            default:
+                fail("ожидалось выражение");
+        }
+    }
+    return results.back();
+}
+
+// операторы и вызовы рекурсивны на стеке вызовов: вложенность ограничена его размером
+void EvalVisitor::exec(StatmNode* node) {
+    if (!node) return;
+    if (frame_address() < bottom) fail("слишком глубокая рекурсия");
+    node->accept(*this);
+}
+
+// ячейка, в которую можно писать: переменная, элемент массива или поле (проверено Resolver).
+// ссылка не устаревает: стек не растет, а объект живет до выхода из своего блока
+Value& EvalVisitor::place(ExprNode& node) {
+    switch (node.kind) {
+        case NodeKind::ID: {
+            auto& id = static_cast<IdExprNode&>(node);
+            return slot(id.depth, id.slot);
+        }
+        case NodeKind::MEMBER_ACCESS: {
+            Value object = eval(*static_cast<MemberAccessExprNode&>(node).object);
+            return locate(node, &object);
+        }
+        case NodeKind::ARRAY_ACCESS: {
+            auto& access = static_cast<ArrayAccessExprNode&>(node);
+            Value operands[2];
+            operands[0] = eval(*access.array);
+            operands[1] = eval(*access.index);
+            return locate(node, operands);
+        }
+        default:
+            fail("ожидалась переменная, элемент массива или поле");
+    }
+}
+
+// ячейка по уже посчитанным операндам: объекту поля или массиву и индексу
+Value& EvalVisitor::locate(ExprNode& node, const Value* operands) {
+    switch (node.kind) {
+        case NodeKind::ID: {
+            auto& id = static_cast<IdExprNode&>(node);
+            return slot(id.depth, id.slot);
+        }
+        case NodeKind::MEMBER_ACCESS:
+            return to_object(operands[0])->slots[static_cast<MemberAccessExprNode&>(node).field];
+        case NodeKind::ARRAY_ACCESS: {
+            auto* array = to_object(operands[0]);
+            int index = to_int(operands[1]);
+            if (index < 0 || static_cast<std::size_t>(index) >= array->slots.size())
+                fail("индекс " + std::to_string(index) + " вне массива из " +
+                     std::to_string(array->slots.size()));
+            return array->slots[index];
+        }
+        default:
+            fail("ожидалась переменная, элемент массива или поле");
+    }
+}
+
+// значение после return и print: выражение или sizeof
+Value EvalVisitor::result(StatmNode& node) {
+    if (node.kind == NodeKind::SIZEOF) {
+        node.accept(*this);
+        return std::move(value);
+    }
+    if (node.kind == NodeKind::EXPR_STATM) {
+        auto* expr = static_cast<ExprStatmNode&>(node).expr;
+        if (expr && expr->kind != NodeKind::VAR_DECL) return eval(*static_cast<ExprNode*>(expr));
+    }
+    fail("ожидалось выражение");
+}
+
+// аргументы пишутся сразу в ячейки параметров нового кадра, над текущим top; вызовы внутри
+// следующих аргументов получают кадр выше уже вычисленных. все, что создано в куче во время
+// вызова, освобождается при выходе, кроме возвращенной структуры
+Value EvalVisitor::call(const FuncDeclNode& func, std::span<ExprNode* const> arguments) {
+    enter(func);
+    const std::size_t frame = top;
+    const std::size_t mark = heap.mark();
+    for (std::size_t i = 0; i < arguments.size(); ++i) bind(func, frame, i, eval(*arguments[i]));
+    return invoke(func, frame, mark);
+}
+
+void EvalVisitor::enter(const FuncDeclNode& func) const {
+    if (!func.body) fail("у функции " + quoted(func.func_name) + " нет тела");
+    if (frame_address() < bottom) fail("слишком глубокая рекурсия");
+    if (top + func.frame_size > STACK_SLOTS) fail("переполнение стека");
+}
+
+void EvalVisitor::bind(const FuncDeclNode& func, std::size_t frame, std::size_t i, const Value& argument) {
+    Value& param = stack[frame + i];
+    param = make(program.type(func.parameters[i].first));
+    assign(param, argument);
+    top = frame + i + 1;
+}
+
+// тело функции в кадре frame с уже записанными параметрами; mark - куча до аргументов
+Value EvalVisitor::invoke(const FuncDeclNode& func, std::size_t frame, std::size_t mark) {
+    const std::size_t caller = base;
+    base = frame;
+    top = frame + func.frame_size;
+    for (auto* statement : func.body->statements) {
+        exec(statement);
+        if (flow != Flow::NEXT) break;
+    }
+    Value returned = flow == Flow::RETURN ? value : Value{};
+    flow = Flow::NEXT;
+    base = caller;
+    top = frame;
+
+    auto type = program.type(func.func_type);
+    if (type == types::VOID) {
+        heap.release(mark);
+        return {};
+    }
+    const std::size_t kept = heap.mark();
+    Value result = make(type);
+    if (returned.index() != values::NOTHING) assign(result, returned);
+    heap.release(mark, kept);
+    return result;
+}
+
+Value EvalVisitor::make(TypeId type) {
+    switch (type) {
+        case types::INT: return 0;
+        case types::FLOAT: return 0.0;
+        case types::CHAR: return '\0';
+        case types::BOOL: return false;
+        case types::VOID: fail("значение типа void");
+        default: break;
+    }
+    const auto& layout = program.structs[type - types::STRUCT];
+    auto* object = heap.allocate(layout.fields.size());
+    for (std::size_t i = 0; i < layout.fields.size(); ++i)
+        declare(object->slots[i], layout.field_types[i], *layout.fields[i]);
+    return object;
+}
+
+// переменная или поле: значение по умолчанию своего типа, затем инициализатор. массив
+// из списка без размера берет размер списка, недостающие элементы остаются по умолчанию
+void EvalVisitor::declare(Value& target, TypeId type, const VariableNode& var) {
+    auto* list = var.init && var.init->kind == NodeKind::ARRAY_INIT ?
+        static_cast<ArrayInitExprNode*>(var.init) : nullptr;
+    if (!var.size && !list) {
+        target = make(type);
+        if (var.init) assign(target, eval(*var.init));
+        return;
+    }
+
+    std::size_t count;
+    if (var.size) {
+        int size = to_int(eval(*var.size));
+        if (size < 0) fail("отрицательный размер массива " + quoted(var.name));
+        count = size;
+    } else {
+        count = list->elements.size();
+    }
+    auto* array = heap.allocate(count);
+    for (auto& element : array->slots) element = make(type);
+    target = array;
+    if (list) {
+        if (list->elements.size() > count) fail("лишние элементы в инициализации " + quoted(var.name));
+        for (std::size_t i = 0; i < list->elements.size(); ++i)
+            assign(array->slots[i], eval(*list->elements[i]));
+    } else if (var.init) {
+        assign(target, eval(*var.init));
+    }
+}
+
+// ветка и правая часть запятой - тоже через eval: глубину цепочки из них проверяет он
+void EvalVisitor::visit(TernaryExprNode& node) {
+    value = eval(truth(eval(*node.condition)) ? *node.true_expr : *node.false_expr);
+}
+
+void EvalVisitor::visit(BinaryExprNode& node) {
+    switch (node.oper) {
+        case OpKind::AND:
+            value = truth(eval(*node.left)) && truth(eval(*node.right));
+            return;
+        case OpKind::OR:
+            value = truth(eval(*node.left)) || truth(eval(*node.right));
+            return;
+        case OpKind::COMMA:
+            eval(*node.left);
+            value = eval(*node.right);
+            return;
+        default: {
+            Value left = eval(*node.left);
+            Value right = eval(*node.right);
+            // частый случай - оба int, без общего разбора типов в arithmetic
+            if (left.is_int() && right.is_int()) {
+                int a = left.as_int();
+                int b = right.as_int();
+                switch (node.oper) {
+                    case OpKind::ADD: value = static_cast<int>(static_cast<unsigned>(a) + static_cast<unsigned>(b)); return;
+                    case OpKind::SUB: value = static_cast<int>(static_cast<unsigned>(a) - static_cast<unsigned>(b)); return;
+                    case OpKind::LT: value = a < b; return;
+                    case OpKind::GT: value = a > b; return;
+                    case OpKind::LEQ: value = a <= b; return;
+                    case OpKind::GEQ: value = a >= b; return;
+                    case OpKind::EQ: value = a == b; return;
+                    case OpKind::NEQ: value = a != b; return;
+                    default: break;
+                }
+            }
+            value = arithmetic(node.oper, left, right);
+        }
+    }
+}
+
+void EvalVisitor::visit(UnaryExprNode& node) {
+    switch (node.oper) {
+        case OpKind::INC:
+        case OpKind::DEC: {
+            Value& target = place(*node.operand);
+            assign(target, arithmetic(step(node.oper), target, 1));
+            value = target;
+            return;
+        }
+        default: value = values::unary(node.oper, eval(*node.operand)); return;
+    }
+}
+
+// правая часть считается первой, составное присваивание читает цель уже после нее
+void EvalVisitor::visit(AssignExprNode& node) {
+    Value right = eval(*node.right);
+    Value& target = place(*node.left);
+    if (node.oper != OpKind::ASSIGN) {
+        // ADD_ASSIGN..MOD_ASSIGN идут в том же порядке, что ADD..MOD
+        auto oper = static_cast<OpKind>(static_cast<int>(node.oper) - static_cast<int>(OpKind::ADD_ASSIGN));
+        right = arithmetic(oper, target, right);
+    }
+    assign(target, right);
+    value = target;
+}
+
+void EvalVisitor::visit(PostfixExprNode& node) {
+    Value& target = place(*node.operand);
+    value = target;
+    assign(target, arithmetic(step(node.oper), target, 1));
+}
+
+void EvalVisitor::visit(LiteralExprNode& node) {
+    value = values::literal(node.value);
+}
+
+void EvalVisitor::visit(IdExprNode& node) {
+    value = slot(node.depth, node.slot);
+}
+
+void EvalVisitor::visit(MemberAccessExprNode& node) {
+    value = place(node);
+}
+
+void EvalVisitor::visit(CallExprNode& node) {
+    value = call(*program.functions[node.function], node.arguments);
+}
+
+void EvalVisitor::visit(ArrayAccessExprNode& node) {
+    value = place(node);
+}
+
+// список вне объявления - временный массив, присваивание скопирует его в цель
+void EvalVisitor::visit(ArrayInitExprNode& node) {
+    auto* array = heap.allocate(node.elements.size());
+    for (std::size_t i = 0; i < node.elements.size(); ++i) array->slots[i] = eval(*node.elements[i]);
+    value = array;
+}
+
+void EvalVisitor::visit(ReturnStatmNode& node) {
+    value = node.expr ? result(*node.expr) : Value{};
+    flow = Flow::RETURN;
+}
+
+void EvalVisitor::visit(BreakStatmNode&) {
+    flow = Flow::BREAK;
+}
+
+void EvalVisitor::visit(ContinueStatmNode&) {
+    flow = Flow::CONTINUE;
+}
+
+void EvalVisitor::visit(ConditionStatmNode& node) {
+    if (truth(eval(*node.condition))) exec(node.then_statm);
+    else exec(node.else_statm);
+}
+
+void EvalVisitor::visit(ExprStatmNode& node) {
+    if (node.expr) node.expr->accept(*this);
+}
+
+// после return куча не чистится: возвращаемое значение может лежать в ней, его забирает call
+void EvalVisitor::visit(BlockStatmNode& node) {
+    const std::size_t mark = heap.mark();
+    for (auto* statement : node.statements) {
+        exec(statement);
+        if (flow != Flow::NEXT) break;
+    }
+    if (flow != Flow::RETURN) heap.release(mark);
+}
+
+// временные объекты условия и тела освобождаются каждую итерацию
+void EvalVisitor::visit(ForStatmNode& node) {
+    const std::size_t mark = heap.mark();
+    if (node.init) node.init->accept(*this);
+    const std::size_t iteration = heap.mark();
+    while (!node.condition || truth(eval(*node.condition))) {
+        exec(node.body);
+        if (flow == Flow::BREAK) {
+            flow = Flow::NEXT;
+            break;
+        }
+        if (flow == Flow::RETURN) return;
+        flow = Flow::NEXT;
+        if (node.incr) eval(*node.incr);
+        heap.release(iteration);
+    }
+    heap.release(mark);
+}
+
+// у do-while первая проверка условия пропускается
+void EvalVisitor::visit(WhileStatmNode& node) {
+    const std::size_t mark = heap.mark();
+    for (bool skip = node.do_while; skip || truth(eval(*node.condition)); skip = false) {
+        exec(node.body);
+        if (flow == Flow::BREAK) {
+            flow = Flow::NEXT;
+            break;
+        }
+        if (flow == Flow::RETURN) return;
+        flow = Flow::NEXT;
+        heap.release(mark);
+    }
+    heap.release(mark);
+}
+
+void EvalVisitor::visit(InputStatmNode& node) {
+    if (!node.expr) return;
+    Value& target = place(*static_cast<ExprNode*>(static_cast<ExprStatmNode*>(node.expr)->expr));
+    if (!values::read(in, target)) fail("не удалось прочитать значение");
+}
+
+void EvalVisitor::visit(OutStatmNode& node) {
+    if (node.expr) values::print(out, result(*node.expr));
+    out << '\n';
+}
+
+void EvalVisitor::visit(SZFStatmNode& node) {
+    value = node.expr ? values::size_of(eval(*node.expr)) : 0;
+}
+
+void EvalVisitor::visit(ExitStatmNode& node) {
+    throw Exit{to_int(eval(*node.expr))};
+}
+
+void EvalVisitor::visit(VarDeclNode& node) {
+    auto type = program.type(node.type);
+    for (auto& var : node.variables) declare(slot(var.depth, var.slot), type, var);
+}
+
+void EvalVisitor::visit(FuncDeclNode&) {}     // функции вызываются через Program::functions
+
+void EvalVisitor::visit(StructDeclNode&) {}   // раскладка полей уже в Program::structs
+
+void EvalVisitor::visit(AssertDeclNode& node) {
+    if (truth(eval(*node.expr))) return;
+    std::string message = "ассерт не выполнен";
+    if (!node.message.empty()) message += ": " + std::string(node.message);
+    fail(message);
+}
+
+// верхний уровень до main: глобальные переменные и ассерты по порядку
+void EvalVisitor::visit(ASTRootNode& node) {
+    for (auto* statement : node.statements) {
+        if (statement) statement->accept(*this);
+    }
+}
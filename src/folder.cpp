@@ -0,0 +1,312 @@
+#include "folder.hpp"
+#include "visitor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+std::size_t count(ASTNode& root) {
+    std::size_t nodes = 0;
+    walk(root, [&nodes](auto&) { ++nodes; });
+    return nodes;
+}
+
+// break или continue, которые относятся к циклу с этим телом; у вложенных циклов - свои
+bool jumps_out(StatmNode* body) {
+    std::vector<ASTNode*> work;
+    if (body) work.push_back(body);
+    while (!work.empty()) {
+        ASTNode* node = work.back();
+        work.pop_back();
+        if (node->kind == NodeKind::BREAK || node->kind == NodeKind::CONTINUE) return true;
+        if (node->kind == NodeKind::FOR || node->kind == NodeKind::WHILE || node->kind <= NodeKind::ARRAY_INIT) continue;
+        for_each_child(*node, [&work](ASTNode& child) { work.push_back(&child); });
+    }
+    return false;
+}
+
+// значение, которое получит переменная скалярного типа до присваивания; для структур и void - нет
+bool default_value(TypeId type, Value& value) {
+    switch (type) {
+        case types::INT: value = 0; return true;
+        case types::FLOAT: value = 0.0; return true;
+        case types::CHAR: value = '\0'; return true;
+        case types::BOOL: value = false; return true;
+        default: return false;
+    }
+}
+
+}
+
+std::size_t Folder::fold(ASTRootNode& root) {
+    globals.assign(program.globals, Value{});
+    locals.clear();
+    conditional = false;
+    std::size_t before = count(root);
+    (*this)(root);
+    return before - count(root);
+}
+
+// узел получает уже свернутые операнды из operands[i] и ставит folded для себя
+ExprNode* Folder::expression(ExprNode* node) {
+    if (!node) return nullptr;
+    auto* result = operands.run(*node, [this](auto& concrete) -> ExprNode* {
+        folded = nullptr;
+        if constexpr (std::is_invocable_v<Folder&, decltype(concrete)>) (*this)(concrete);
+        return folded ? folded : &concrete;
+    });
+    folded = nullptr;
+    return result;
+}
+
+StatmNode* Folder::statement(StatmNode* node) {
+    if (!node) return nullptr;
+    kept = node;
+    visit(*node, *this);
+    return kept;
+}
+
+// объявление в ветке без скобок видно и после if, но выполняется не всегда - его значение
+// не запоминается
+StatmNode* Folder::branch(StatmNode* node) {
+    if (!node || node->kind == NodeKind::BLOCK) return statement(node);
+    bool saved = conditional;
+    conditional = true;
+    auto* result = statement(node);
+    conditional = saved;
+    return result;
+}
+
+// литерал на место выражения; массивы, структуры и void литералом не записать
+void Folder::replace(const Value& value) {
+    switch (value.index()) {
+        case values::INT: folded = arena.make<LiteralExprNode>(value.as_int()); break;
+        case values::DOUBLE: folded = arena.make<LiteralExprNode>(value.as_double()); break;
+        case values::BOOL: folded = arena.make<LiteralExprNode>(value.as_bool()); break;
+        case values::CHAR: folded = arena.make<LiteralExprNode>(value.as_char()); break;
+        case values::STRING: folded = arena.make<LiteralExprNode>(value.as_string()); break;
+        default: break;
+    }
+}
+
+bool Folder::constant(const ExprNode* node, Value& value) {
+    if (!node || node->kind != NodeKind::LITERAL) return false;
+    value = values::literal(static_cast<const LiteralExprNode*>(node)->value);
+    return true;
+}
+
+void Folder::operator()(TernaryExprNode& node) {
+    node.condition = operands[0];
+    node.true_expr = operands[1];
+    node.false_expr = operands[2];
+    Value condition;
+    if (!constant(node.condition, condition)) return;
+    try {
+        folded = values::truth(condition) ? node.true_expr : node.false_expr;
+    } catch (const std::runtime_error&) {}
+}
+
+// у && и || правая часть считается, только если левой не хватило; у запятой от литерала
+// слева остается правая часть
+void Folder::operator()(BinaryExprNode& node) {
+    node.left = operands[0];
+    node.right = operands[1];
+    Value left, right;
+    if (!constant(node.left, left)) return;
+    bool known = constant(node.right, right);
+    try {
+        switch (node.oper) {
+            case OpKind::COMMA:
+                folded = node.right;
+                break;
+            case OpKind::AND:
+            case OpKind::OR: {
+                bool decisive = node.oper == OpKind::OR;
+                if (values::truth(left) == decisive) replace(decisive);
+                else if (known) replace(values::truth(right));
+                break;
+            }
+            default:
+                if (known) replace(values::arithmetic(node.oper, left, right));
+                break;
+        }
+    } catch (const std::runtime_error&) {}
+}
+
+void Folder::operator()(UnaryExprNode& node) {
+    node.operand = operands[0];
+    Value operand;
+    if (node.oper == OpKind::INC || node.oper == OpKind::DEC || !constant(node.operand, operand)) return;
+    try {
+        replace(values::unary(node.oper, operand));
+    } catch (const std::runtime_error&) {}
+}
+
+// цель присваивания - не константа, это проверил Resolver
+void Folder::operator()(AssignExprNode& node) {
+    node.left = operands[0];
+    node.right = operands[1];
+}
+
+void Folder::operator()(PostfixExprNode& node) {
+    node.operand = operands[0];
+}
+
+void Folder::operator()(IdExprNode& node) {
+    const auto& known = node.depth ? locals : globals;
+    if (node.slot < known.size()) replace(known[node.slot]);
+}
+
+void Folder::operator()(MemberAccessExprNode& node) {
+    node.object = operands[0];
+}
+
+void Folder::operator()(CallExprNode& node) {
+    for (std::size_t i = 0; i < node.arguments.size(); ++i) node.arguments[i] = operands[i];
+}
+
+void Folder::operator()(ArrayAccessExprNode& node) {
+    node.array = operands[0];
+    node.index = operands[1];
+}
+
+void Folder::operator()(ArrayInitExprNode& node) {
+    for (std::size_t i = 0; i < node.elements.size(); ++i) node.elements[i] = operands[i];
+}
+
+void Folder::operator()(ReturnStatmNode& node) {
+    node.expr = statement(node.expr);
+    kept = &node;
+}
+
+// при известном условии обходится только выполняемая ветка: объявления в другой не нужны
+void Folder::operator()(ConditionStatmNode& node) {
+    node.condition = expression(node.condition);
+    Value condition;
+    if (constant(node.condition, condition)) {
+        try {
+            kept = branch(values::truth(condition) ? node.then_statm : node.else_statm);
+            return;
+        } catch (const std::runtime_error&) {}
+    }
+    node.then_statm = branch(node.then_statm);
+    node.else_statm = branch(node.else_statm);
+    kept = &node;
+}
+
+void Folder::operator()(ExprStatmNode& node) {
+    if (!node.expr) return;
+    if (node.expr->kind == NodeKind::VAR_DECL) visit(*node.expr, *this);
+    else node.expr = expression(static_cast<ExprNode*>(node.expr));
+}
+
+void Folder::operator()(BlockStatmNode& node) {
+    bool saved = conditional;
+    conditional = false;
+    for (auto*& statement : node.statements) statement = this->statement(statement);
+    std::erase(node.statements, nullptr);
+    conditional = saved;
+    kept = &node;
+}
+
+// for с ложным условием - только init, он выполняется и тогда
+void Folder::operator()(ForStatmNode& node) {
+    if (node.init && node.init->kind == NodeKind::VAR_DECL) visit(*node.init, *this);
+    else node.init = expression(static_cast<ExprNode*>(node.init));
+    node.condition = expression(node.condition);
+    Value condition;
+    try {
+        if (constant(node.condition, condition) && !values::truth(condition)) {
+            kept = node.init ? arena.make<ExprStatmNode>(node.init) : nullptr;
+            return;
+        }
+    } catch (const std::runtime_error&) {}
+    node.incr = expression(node.incr);
+    node.body = branch(node.body);
+    kept = &node;
+}
+
+// do-while с ложным условием выполняет тело ровно раз - остается само тело, если в нем
+// нет break и continue самого цикла
+void Folder::operator()(WhileStatmNode& node) {
+    node.condition = expression(node.condition);
+    Value condition;
+    bool never = false;
+    try {
+        never = constant(node.condition, condition) && !values::truth(condition);
+    } catch (const std::runtime_error&) {}
+    if (never && !node.do_while) {
+        kept = nullptr;
+        return;
+    }
+    node.body = branch(node.body);
+    kept = never && !jumps_out(node.body) ? node.body : &node;
+}
+
+void Folder::operator()(InputStatmNode& node) {
+    node.expr = statement(node.expr);
+    kept = &node;
+}
+
+void Folder::operator()(OutStatmNode& node) {
+    node.expr = statement(node.expr);
+    kept = &node;
+}
+
+void Folder::operator()(SZFStatmNode& node) {
+    node.expr = expression(node.expr);
+}
+
+void Folder::operator()(ExitStatmNode& node) {
+    node.expr = expression(node.expr);
+}
+
+// значение константы приводится к ее типу, как при присваивании; ячейка любого другого
+// объявления забывает прежнее значение
+void Folder::operator()(VarDeclNode& node) {
+    auto type = program.type(node.type);
+    for (auto& var : node.variables) {
+        var.size = expression(var.size);
+        var.init = expression(var.init);
+        auto& known = var.depth ? locals : globals;
+        if (var.slot >= known.size()) continue;
+        Value value, init;
+        if (node.constant && !conditional && !var.size && constant(var.init, init) && default_value(type, value)) {
+            try {
+                values::assign(value, init);
+            } catch (const std::runtime_error&) {
+                value = Value{};
+            }
+        }
+        known[var.slot] = value;
+    }
+}
+
+void Folder::operator()(FuncDeclNode& node) {
+    if (!node.body) return;
+    locals.assign(node.frame_size, Value{});
+    statement(node.body);
+}
+
+// поля не занимают ячеек, у них сворачиваются только выражения
+void Folder::operator()(StructDeclNode& node) {
+    for (auto* decl : node.fields) {
+        if (!decl) continue;
+        for (auto& var : decl->variables) {
+            var.size = expression(var.size);
+            var.init = expression(var.init);
+        }
+    }
+}
+
+void Folder::operator()(AssertDeclNode& node) {
+    node.expr = expression(node.expr);
+}
+
+void Folder::operator()(ASTRootNode& node) {
+    for (auto* statement : node.statements) {
+        if (statement) visit(*statement, *this);
+    }
+}
@@ -1,16 +1,25 @@
 #include "lexer.hpp"
+#include "scan.hpp"
 
 #include <iostream>
 #include <cctype>
 #include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <thread>
 
-Lexer::Lexer(const std::string& input) : input(input) {}
+Lexer::Lexer(const SourceBuffer& source) : source(source), input(source.view()) {}
+
+Token Lexer::next() {
+    return extract();
+}
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
 
     while (true) {
-        Token token = extract();
+        Token token = next();
         tokens.push_back(token);
         if (token.type == TokenType::END_OF_FILE) break;
     }
@@ -18,17 +27,173 @@ std::vector<Token> Lexer::tokenize() {
     return tokens;
 }
 
+std::vector<Token> Lexer::tokenize_parallel(std::size_t threads) {
+    // на маленьких входах запуск потоков дороже самого лексинга
+    constexpr std::size_t MIN_CHUNK = 1 << 20;
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, (input.size() - index) / MIN_CHUNK);
+    if (threads <= 1) return tokenize();
+
+    std::string_view rest = input.substr(index);
+    std::vector<std::size_t> bounds = split_points(rest, threads);
+    bounds.insert(bounds.begin(), 0);
+    bounds.push_back(rest.size());
+
+    std::vector<std::future<std::vector<Token>>> chunks;
+    for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+        std::string_view chunk = rest.substr(bounds[i], bounds[i + 1] - bounds[i]);
+        chunks.push_back(std::async(std::launch::async, [this, chunk] {
+            return Lexer(source, chunk).tokenize();
+        }));
+    }
+
+    // склейка по порядку: END_OF_FILE остается только у последнего куска,
+    // первая ошибка по тексту пробрасывается так же, как из tokenize()
+    std::vector<std::vector<Token>> parts;
+    std::size_t total = 0;
+    for (auto& chunk : chunks) {
+        parts.push_back(chunk.get());
+        total += parts.back().size();
+    }
+    std::vector<Token> tokens;
+    tokens.reserve(total);
+    for (const auto& part : parts) {
+        if (!tokens.empty()) tokens.pop_back();
+        tokens.insert(tokens.end(), part.begin(), part.end());
+    }
+    index = input.size();
+    return tokens;
+}
+
+// переводы строк вне строк, символьных литералов и /* */ комментариев:
+// разрез по ним не меняет ни одного токена. берется первый такой перевод строки
+// после каждой из parts - 1 равных долей входа
+std::vector<std::size_t> Lexer::split_points(std::string_view text, std::size_t parts) {
+    std::vector<std::size_t> points;
+    std::size_t target = text.size() / parts;
+    std::size_t i = 0;
+    while (i < text.size() && points.size() + 1 < parts) {
+        switch (text[i]) {
+            case '\n':
+                if (i + 1 >= target) {
+                    points.push_back(i + 1);
+                    target = text.size() / parts * (points.size() + 1);
+                }
+                ++i;
+                break;
+            case '"':
+                i = text.find('"', i + 1);
+                i = i == std::string_view::npos ? text.size() : i + 1;
+                break;
+            case '\'':
+                i = text.find('\'', i + (text.substr(i + 1, 1) == "\\" ? 3 : 2));
+                i = i == std::string_view::npos ? text.size() : i + 1;
+                break;
+            case '/':
+                if (text.substr(i, 2) == "/*") {
+                    i = text.find("*/", i + 2);
+                    i = i == std::string_view::npos ? text.size() : i + 2;
+                } else if (text.substr(i, 2) == "//") {
+                    i = std::min(text.find('\n', i + 2), text.size()); // сам перевод строки - точка разреза
+                } else {
+                    ++i;
+                }
+                break;
+            default:
+                ++i;
+        }
+    }
+    return points;
+}
+
+namespace {
+
+// границы лексемы в буфере: у строк и символов значение не включает кавычки
+std::size_t lexeme_begin(const SourceBuffer& source, const Token& token) {
+    std::size_t begin = source.offset_of(token.value);
+    return token.type == TokenType::STR_LIT || token.type == TokenType::CHAR_LIT ? begin - 1 : begin;
+}
+
+std::size_t lexeme_end(const SourceBuffer& source, const Token& token) {
+    std::size_t end = source.offset_of(token.value) + token.value.size();
+    return token.type == TokenType::STR_LIT || token.type == TokenType::CHAR_LIT ? end + 1 : end;
+}
+
+Token rebase(Token token, const SourceBuffer& from, const SourceBuffer& to, std::ptrdiff_t shift) {
+    token.value = {to.view().data() + from.offset_of(token.value) + shift, token.value.size()};
+    return token;
+}
+
+}
+
+Lexer::TokenRange Lexer::relex(const SourceBuffer& old, const SourceBuffer& updated,
+                               std::vector<Token>& tokens, const SourceEdit& edit) {
+    // лексер заглядывает вперед не дальше чем на 3 символа (1e+5), поэтому токен,
+    // кончающийся ближе к правке, мог бы разобраться иначе - его лексим заново
+    constexpr std::size_t LOOKAHEAD = 3;
+
+    std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(edit.inserted.size()) - static_cast<std::ptrdiff_t>(edit.removed);
+    if (updated.size() != old.size() + shift)
+        throw std::runtime_error("Новый буфер не соответствует правке");
+
+    std::size_t first = std::partition_point(tokens.begin(), tokens.end(), [&](const Token& token) {
+        return token.type != TokenType::END_OF_FILE && lexeme_end(old, token) + LOOKAHEAD < edit.offset;
+    }) - tokens.begin();
+    std::size_t restart = first == 0 ? 0 : lexeme_end(old, tokens[first - 1]);
+
+    // в новом буфере текст после edit_end совпадает со старым со сдвигом shift
+    std::size_t edit_end = edit.offset + edit.inserted.size();
+    std::vector<Token> fresh;
+    std::size_t old_end = first;
+    Lexer lexer(updated);
+    lexer.index = restart;
+    while (true) {
+        Token token = lexer.next();
+        std::size_t begin = lexeme_begin(updated, token);
+        if (begin >= edit_end) {
+            // синхронизация: старый токен начинается там же - дальше потоки совпадают
+            while (old_end < tokens.size() && lexeme_begin(old, tokens[old_end]) + shift < begin) ++old_end;
+            if (old_end < tokens.size() && lexeme_begin(old, tokens[old_end]) + shift == begin &&
+                tokens[old_end].type == token.type && tokens[old_end].value.size() == token.value.size()) break;
+        }
+        fresh.push_back(token);
+        if (token.type == TokenType::END_OF_FILE) {
+            old_end = tokens.size();
+            break;
+        }
+    }
+
+    // токены - виды в буфер, поэтому нетронутые части только переносятся в новый буфер
+    for (std::size_t i = 0; i < first; ++i) tokens[i] = rebase(tokens[i], old, updated, 0);
+    for (std::size_t i = old_end; i < tokens.size(); ++i) tokens[i] = rebase(tokens[i], old, updated, shift);
+    std::size_t common = std::min(fresh.size(), old_end - first);
+    std::copy(fresh.begin(), fresh.begin() + common, tokens.begin() + first);
+    if (fresh.size() < old_end - first) {
+        tokens.erase(tokens.begin() + first + common, tokens.begin() + old_end);
+    } else {
+        tokens.insert(tokens.begin() + old_end, fresh.begin() + common, fresh.end());
+    }
+
+    return {first, old_end, first + fresh.size()};
+}
+
 Token Lexer::extract() {
-    while (std::isspace(peek())) advance();
+    // комментарии подряд пропускаются циклом, а не повторным extract(): их может быть сколько угодно
+    index = scan::skip_space(input, index);
+    while (peek() == '/' && (peek(1) == '/' || peek(1) == '*')) {
+        skip_comment();
+        index = scan::skip_space(input, index);
+    }
 
     if (index >= input.size()) {
-        return {TokenType::END_OF_FILE, ""};
+        return {TokenType::END_OF_FILE, input.substr(input.size())};
     }
 
-    if (std::isalpha(peek()) || peek() == '_') {
+    if (scan::is(peek(), scan::ALPHA)) {
         return extract_id();
     }
-    if (std::isdigit(peek())) {
+    if (scan::is(peek(), scan::DIGIT)) {
         return extract_num();
     }
     if (peek() == '\'') {
@@ -37,99 +202,200 @@ Token Lexer::extract() {
     if (peek() == '"') {     
         return extract_str();
     }
-    if (peek() == '/') {
-        skip_comment();
-    }
     return extract_op();
 }
 
 Token Lexer::extract_id() {
     std::size_t start = index;
-    while (std::isalnum(peek()) || peek() == '_') advance();
-    std::string value = input.substr(start, index - start);
-    if (keywords.contains(value)) {
-        return {keywords.at(value), value};
-    }
-    if (value == "true" || value == "false") return {TokenType::BOOL_LIT, value};
-    return {TokenType::ID, value};
+    index = scan::skip_ident(input, index);
+    std::string_view value = input.substr(start, index - start);
+    TokenType type = keyword(value);
+    if (type == TokenType::BOOL_LIT) return {type, value, value[0] == 't'};
+    return {type, value};
 }
 
+// целые: десятичные, 0x.. шестнадцатеричные, 0b.. двоичные, 0.. восьмеричные;
+// вещественные: с точкой и/или показателем степени. значение разбирается здесь один раз
 Token Lexer::extract_num() {
     std::size_t start = index;
-    while (std::isdigit(peek())) advance();
-    if (peek() == '.') {
-        advance();
-        while (std::isdigit(peek())) advance();
-        return {TokenType::FLOAT_LIT, input.substr(start, index - start)};
+    int base = 10;
+    if (peek() == '0' && (peek(1) == 'x' || peek(1) == 'X')) {
+        base = 16;
+        advance(2);
+        while (std::isxdigit(static_cast<unsigned char>(peek()))) advance();
+    } else if (peek() == '0' && (peek(1) == 'b' || peek(1) == 'B')) {
+        base = 2;
+        advance(2);
+        index = scan::skip_digits(input, index);
+    } else {
+        index = scan::skip_digits(input, index);
+        bool is_float = false;
+        if (peek() == '.') {
+            is_float = true;
+            index = scan::skip_digits(input, index + 1);
+        }
+        if ((peek() == 'e' || peek() == 'E') &&
+            (scan::is(peek(1), scan::DIGIT) || ((peek(1) == '+' || peek(1) == '-') && scan::is(peek(2), scan::DIGIT)))) {
+            is_float = true;
+            index = scan::skip_digits(input, index + 2);
+        }
+        std::string_view text = input.substr(start, index - start);
+        if (is_float) {
+            double value = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (error == std::errc::result_out_of_range) report("вещественное число вне диапазона: " + std::string(text));
+            return {TokenType::FLOAT_LIT, text, value};
+        }
+        if (text.size() > 1 && text[0] == '0') base = 8;
     }
-    return {TokenType::INT_LIT, input.substr(start, index - start)};
+
+    std::string_view text = input.substr(start, index - start);
+    std::string_view digits = base == 8 ? text.substr(1) : base == 10 ? text : text.substr(2);
+    int value = 0;
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value, base);
+    if (error == std::errc::result_out_of_range) report("целое число не помещается в int: " + std::string(text));
+    if (digits.empty() || error != std::errc() || end != digits.data() + digits.size())
+        report("неверная запись числа: " + std::string(text));
+    return {TokenType::INT_LIT, text, value};
 }
 
+// значение токена - текст между кавычками, literal - разобранный символ
 Token Lexer::extract_char() {
     advance();
-    char c;
-    if (peek() == '\\') {
-        advance();
-        if (std::isalpha(peek())) {
-            std::string value = "\\" + peek();
-            if (esc_chars.contains(value)) return {esc_chars.at(value), value};
-        }
-        switch (peek()) {
-            case '\'' : c = '\'';
-            case '\"' : c = '\"';
-            case '\\' : c = '\\';
-            case '\?' : c = '\?';
-            default : report("неизвестный символ \'" + peek() + '\'');
-        }
-    }
+    std::size_t start = index;
+    char c = peek();
+    if (c == '\\') c = extract_escape();
+    else if (c == '\'' || index >= input.size()) report("пустой символьный литерал");
+    else advance();
 
-    c = peek();
-    advance();
     if (peek() != '\'') report("не закрыта кавычка");
+    std::string_view value = input.substr(start, index - start);
     advance();
-    return {TokenType::CHAR_LIT, std::string(1, c)};
+    return {TokenType::CHAR_LIT, value, c};
 }
 
-Token Lexer::extract_str() {
+// стоит на '\', продвигается за конец последовательности
+char Lexer::extract_escape() {
     advance();
-    std::size_t start = index;
-    while (peek() != '"' && index <= input.size()) {
-        advance();
+    char c = peek();
+    advance();
+    switch (c) {
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case 'v': return '\v';
+        case '\'': case '"': case '\\': case '?':
+            return c;
+        case 'x': {
+            std::size_t start = index;
+            while (std::isxdigit(static_cast<unsigned char>(peek()))) advance();
+            unsigned value = 0;
+            auto [end, error] = std::from_chars(input.data() + start, input.data() + index, value, 16);
+            if (index == start || error != std::errc() || value > 0xFF)
+                report("неверная шестнадцатеричная escape-последовательность");
+            return static_cast<char>(value);
+        }
+        default:
+            if (c >= '0' && c <= '7') {
+                std::size_t start = index - 1;
+                while (index - start < 3 && peek() >= '0' && peek() <= '7') advance();
+                unsigned value = 0;
+                std::from_chars(input.data() + start, input.data() + index, value, 8);
+                if (value > 0xFF) report("восьмеричная escape-последовательность больше байта");
+                return static_cast<char>(value);
+            }
+            report(std::string("неизвестная escape-последовательность \\") + c);
     }
+}
 
-    if (index > input.size() || peek() != '"') report("не закрыта кавычка");
-    std::string value = input.substr(start, index - start);
+Token Lexer::extract_str() {
+    advance();
+    std::size_t start = index;
+    index = scan::find_quote(input, index);
+    if (index >= input.size()) report("не закрыта кавычка");
+    std::string_view value = input.substr(start, index - start);
     advance();
     return {TokenType::STR_LIT, value};
 }
 
 Token Lexer::extract_op() {
-    std::size_t size = 0;
-    std::string op;
-    while (operators.contains(op + peek(size))) {
-        op += peek(size);
-        ++size;
+    // максимальное совпадение: сначала пробуем двухсимвольные операторы
+    char next = peek(1);
+    switch (peek()) {
+        case '+':
+            if (next == '+') return make_token(TokenType::INCREMENT, 2);
+            if (next == '=') return make_token(TokenType::PLUS_ASSIGN, 2);
+            return make_token(TokenType::PLUS, 1);
+        case '-':
+            if (next == '-') return make_token(TokenType::DECREMENT, 2);
+            if (next == '=') return make_token(TokenType::MINUS_ASSIGN, 2);
+            if (next == '>') return make_token(TokenType::ARROW, 2);
+            return make_token(TokenType::MINUS, 1);
+        case '*':
+            if (next == '=') return make_token(TokenType::STAR_ASSIGN, 2);
+            return make_token(TokenType::STAR, 1);
+        case '/':
+            if (next == '=') return make_token(TokenType::SLASH_ASSIGN, 2);
+            return make_token(TokenType::SLASH, 1);
+        case '%':
+            if (next == '=') return make_token(TokenType::PERCENT_ASSIGN, 2);
+            return make_token(TokenType::PERCENT, 1);
+        case '=':
+            if (next == '=') return make_token(TokenType::EQ, 2);
+            return make_token(TokenType::ASSIGN, 1);
+        case '!':
+            if (next == '=') return make_token(TokenType::NEQ, 2);
+            return make_token(TokenType::NOT, 1);
+        case '<':
+            if (next == '=') return make_token(TokenType::LEQ, 2);
+            if (next == '<') return make_token(TokenType::BIT_SHL, 2);
+            return make_token(TokenType::LT, 1);
+        case '>':
+            if (next == '=') return make_token(TokenType::GEQ, 2);
+            if (next == '>') return make_token(TokenType::BIT_SHR, 2);
+            return make_token(TokenType::GT, 1);
+        case '&':
+            if (next == '&') return make_token(TokenType::AND, 2);
+            return make_token(TokenType::BIT_AND, 1);
+        case '|':
+            if (next == '|') return make_token(TokenType::OR, 2);
+            return make_token(TokenType::BIT_OR, 1);
+        case '^': return make_token(TokenType::BIT_XOR, 1);
+        case '~': return make_token(TokenType::BIT_NOT, 1);
+        case '?': return make_token(TokenType::QMARK, 1);
+        case ':': return make_token(TokenType::COLON, 1);
+        case ',': return make_token(TokenType::COMMA, 1);
+        case ';': return make_token(TokenType::SEMICOLON, 1);
+        case '.': return make_token(TokenType::DOT, 1);
+        case '(': return make_token(TokenType::LPAREN, 1);
+        case ')': return make_token(TokenType::RPAREN, 1);
+        case '{': return make_token(TokenType::LBRACE, 1);
+        case '}': return make_token(TokenType::RBRACE, 1);
+        case '[': return make_token(TokenType::LBRACKET, 1);
+        case ']': return make_token(TokenType::RBRACKET, 1);
     }
+    report(std::string("Неизвестный символ: ") + peek());
+}
+
+Token Lexer::make_token(TokenType type, std::size_t size) noexcept {
+    Token token{type, input.substr(index, size)};
     advance(size);
-    if (operators.contains(op)) {
-        return {operators.at(op), op};
-    }
-    report("Неизвестный символ: " + op);
+    return token;
 }
 
 void Lexer::skip_comment() {
-    advance();
-    std::string value  = "/" + peek();
-    if(!comm_sym.contains(value)) report("Неизвестный символ: \'/" + peek() + '\'');
-    std::size_t start = index;
-    if (comm_sym.at(value) == TokenType::COMLIT) {
-        while(peek() != '\n') advance();
+    bool line_comment = peek(1) == '/';
+    advance(2);
+    if (line_comment) {
+        index = std::min(input.find('\n', index), input.size());
+        return;
     }
-    if (comm_sym.at(value) == TokenType::LCOMLIT) {
-        while(!(peek(1) == '/' && peek() == '*')) advance();
-    }
-    advance();
-    extract();
+    std::size_t end = input.find("*/", index);
+    if (end == std::string_view::npos) report("не закрыт комментарий");
+    index = end + 2;
 }
 
 char Lexer::peek(std::size_t offset) const noexcept {
@@ -141,85 +407,55 @@ void Lexer::advance(std::size_t offset) noexcept {
 }
 
 void Lexer::report(const std::string& message) const {
-    throw std::runtime_error(message);
-}
-
-const std::unordered_map<std::string, TokenType> Lexer::comm_sym = {
-    {"//", TokenType::COMLIT},
-    {"/*", TokenType::LCOMLIT},
-    {"*/", TokenType::RCOMLIT},
-};
-
-const std::unordered_map<std::string, TokenType> Lexer::esc_chars = {
-    {"\\a", TokenType::ESCLIT},
-    {"\\b", TokenType::ESCLIT},
-    {"\\f", TokenType::ESCLIT},
-    {"\\n", TokenType::ESCLIT},
-    {"\\r", TokenType::ESCLIT},
-    {"\\t", TokenType::ESCLIT},
-    {"\\v", TokenType::ESCLIT},
-};
-
-const std::unordered_map<std::string, TokenType> Lexer::keywords = {
-    {"int", TokenType::KW_INT},
-    {"float", TokenType::KW_FLOAT},
-    {"char", TokenType::KW_CHAR},
-    {"bool", TokenType::KW_BOOL},
-    {"void", TokenType::KW_VOID},
-    {"struct", TokenType::KW_STRUCT},
-    {"if", TokenType::KW_IF},
-    {"else", TokenType::KW_ELSE},
-    {"while", TokenType::KW_WHILE},
-    {"do", TokenType::KW_DO},
-    {"for", TokenType::KW_FOR},
-    {"return", TokenType::KW_RETURN},
-    {"break", TokenType::KW_BREAK},
-    {"continue", TokenType::KW_CONTINUE},
-    {"assert", TokenType::KW_ASSERT},
-    {"const", TokenType::KW_CONST},
-    {"exit", TokenType::KW_EXIT},
-    {"print", TokenType::KW_PRINT},
-    {"read", TokenType::KW_READ},
-    {"sizeof", TokenType::KW_SIZEOF},
-};
-
-const std::unordered_map<std::string, TokenType> Lexer::operators = {
-    {"+", TokenType::PLUS},
-    {"-", TokenType::MINUS},
-    {"*", TokenType::STAR},
-    {"/", TokenType::SLASH},
-    {"=", TokenType::ASSIGN},
-    {"+=", TokenType::PLUS_ASSIGN},
-    {"-=", TokenType::MINUS_ASSIGN},
-    {"*=", TokenType::STAR_ASSIGN},
-    {"/=", TokenType::SLASH_ASSIGN},
-    {"==", TokenType::EQ},
-    {"!=", TokenType::NEQ},
-    {"<", TokenType::LT},
-    {">", TokenType::GT},
-    {"<=", TokenType::LEQ},
-    {">=", TokenType::GEQ},
-    {"&&", TokenType::AND},
-    {"||", TokenType::OR},
-    {"!", TokenType::NOT},
-    {"&", TokenType::BIT_AND},
-    {"|", TokenType::BIT_OR},
-    {"^", TokenType::BIT_XOR},
-    {"~", TokenType::BIT_NOT},
-    {"<<", TokenType::BIT_SHL},
-    {">>", TokenType::BIT_SHR},
-    {"++", TokenType::INCREMENT},
-    {"--", TokenType::DECREMENT},
-    {"?", TokenType::QMARK},
-    {":", TokenType::COLON},
-    {",", TokenType::COMMA},
-    {";", TokenType::SEMICOLON},
-    {".", TokenType::DOT},
-    {"->", TokenType::ARROW},
-    {"(", TokenType::LPAREN},
-    {")", TokenType::RPAREN},
-    {"{", TokenType::LBRACE},
-    {"}", TokenType::RBRACE},
-    {"[", TokenType::LBRACKET},
-    {"]", TokenType::RBRACKET}
-};
+    throw std::runtime_error(source.where(source.offset_of(input) + index) + ": " + message);
+}
+
+constexpr TokenType Lexer::keyword(std::string_view value) noexcept {
+    // длина и первый символ однозначно выбирают кандидата, дальше одно сравнение
+    auto match = [value](std::string_view word, TokenType type) {
+        return value == word ? type : TokenType::ID;
+    };
+    switch (value.size()) {
+        case 2:
+            switch (value[0]) {
+                case 'i': return match("if", TokenType::KW_IF);
+                case 'd': return match("do", TokenType::KW_DO);
+            }
+            break;
+        case 3:
+            switch (value[0]) {
+                case 'i': return match("int", TokenType::KW_INT);
+                case 'f': return match("for", TokenType::KW_FOR);
+            }
+            break;
+        case 4:
+            switch (value[0]) {
+                case 'c': return match("char", TokenType::KW_CHAR);
+                case 'b': return match("bool", TokenType::KW_BOOL);
+                case 'v': return match("void", TokenType::KW_VOID);
+                case 'e': return value[1] == 'l' ? match("else", TokenType::KW_ELSE) : match("exit", TokenType::KW_EXIT);
+                case 'r': return match("read", TokenType::KW_READ);
+                case 't': return match("true", TokenType::BOOL_LIT);
+            }
+            break;
+        case 5:
+            switch (value[0]) {
+                case 'f': return value[1] == 'l' ? match("float", TokenType::KW_FLOAT) : match("false", TokenType::BOOL_LIT);
+                case 'w': return match("while", TokenType::KW_WHILE);
+                case 'b': return match("break", TokenType::KW_BREAK);
+                case 'c': return match("const", TokenType::KW_CONST);
+                case 'p': return match("print", TokenType::KW_PRINT);
+            }
+            break;
+        case 6:
+            switch (value[0]) {
+                case 's': return value[1] == 't' ? match("struct", TokenType::KW_STRUCT) : match("sizeof", TokenType::KW_SIZEOF);
+                case 'r': return match("return", TokenType::KW_RETURN);
+                case 'a': return match("assert", TokenType::KW_ASSERT);
+            }
+            break;
+        case 8:
+            return match("continue", TokenType::KW_CONTINUE);
+    }
+    return TokenType::ID;
+}
@@ -1,50 +1,169 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <future>
 
+#include "source.hpp"
 #include "lexer.hpp"
+#include "token_stream.hpp"
 #include "token.hpp"
 #include "parcer.hpp"
 #include "visitor.hpp"
+#include "ast_cache.hpp"
+#include "resolver.hpp"
+#include "folder.hpp"
+#include "eval.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
 
-std::string readfile (const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file) {
-        throw std::runtime_error("Не получилось получить доступ к файлу: " + filepath);
+// все файлы отображаются в память параллельно, по задаче на файл
+std::vector<std::future<std::unique_ptr<SourceBuffer>>> load_sources(const std::vector<std::string>& paths) {
+    std::vector<std::future<std::unique_ptr<SourceBuffer>>> sources;
+    for (const auto& path : paths) {
+        sources.push_back(std::async(std::launch::async, SourceBuffer::map_file, path));
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    return sources;
 }
 
-int main() {
-    try {
-        std::string input = readfile("prg.txt");
-        Lexer lexer(input);
+// --check: только проверка, все синтаксические ошибки файла за один проход
+bool check(const SourceBuffer& source) {
+    Lexer lexer(source);
+    AstArena arena;
+    Parcer parcer(lexer, arena);
+    parcer.parce(ParceMode::RECOVER);
+    for (const auto& diagnostic : parcer.getDiagnostics()) {
+        std::cerr << "Ошибка: " << parcer.describe(diagnostic) << std::endl;
+    }
+    return parcer.getDiagnostics().empty();
+}
+
+void run(const SourceBuffer& source, bool dump_tokens, const AstCache* cache) {
+    AstArena arena;
+    // --cache: дерево того же текста уже разобрано раньше, лексер и парсер не нужны
+    if (cache && !dump_tokens) {
+        if (auto* ast = cache->load(source, arena)) {
+            std::cout << "AST из кэша" << std::endl;
+            std::cout << "__________________________" << std::endl;
+            PrintVisitor visitor;
+            visitor.print(*ast);
+            return;
+        }
+    }
+
+    Lexer lexer(source);
+
+    // --tokens: сначала весь поток токенов, парсер работает по готовому TokenStream;
+    // иначе парсер тянет токены из лексера по одному
+    std::unique_ptr<TokenStream> stream;
+    if (dump_tokens) {
         std::cout << "лексер нач" << std::endl;
-        std::vector<Token> tokens = lexer.tokenize();
+        stream = std::make_unique<TokenStream>(source);
         std::cout << "лексер кон" << std::endl;
 
-        for (const Token& token : tokens) {
+        for (std::size_t i = 0; i < stream->size(); ++i) {
+            Token token = (*stream)[i];
             std::cout << "Токен: " << tokenTypeToString(token.type)
                       << ", Значение: \"" << token.value << "\"" << std::endl;
         }
+    }
 
-        Parcer parcer(tokens);
-        std::cout << "парсер нач" << std::endl;
+    Parcer parcer = stream ? Parcer(*stream, arena) : Parcer(lexer, arena);
+    std::cout << "парсер нач" << std::endl;
+    if (stream) parcer.parce_parallel();
+    else parcer.parce();
+    std::cout << "парсер кон" << std::endl;
+    auto ast = parcer.getASTRoot();
+    if (cache) cache->store(source, *ast);
+
+    std::cout << "__________________________" << std::endl;
+    PrintVisitor visitor;
+    visitor.print(*ast);
+}
+
+enum class Backend { VM, AST, DISASM };
+
+// --run: выполнение программы с main на байткоде; --run-ast - обходом дерева, --disasm -
+// только печать байткода и числа узлов, убранных сверткой констант. перед выполнением
+// дерево всегда сворачивается. код выхода - то, что вернула main или exit(...).
+// без кэша тела функций разбираются лениво: только те, до которых доходят вызовы, так что
+// ошибки в остальных не видны. в кэш пишется дерево целиком - с ним разбирается все сразу
+int execute(const SourceBuffer& source, const AstCache* cache, Backend backend) {
+    AstArena arena;
+    Resolver resolver;
+    std::unique_ptr<TokenStream> stream;
+    ASTRootNode* ast = cache ? cache->load(source, arena) : nullptr;
+    if (!ast && cache) {
+        Lexer lexer(source);
+        Parcer parcer(lexer, arena);
+        parcer.parce();
+        ast = static_cast<ASTRootNode*>(parcer.getASTRoot());
+        cache->store(source, *ast);
+    } else if (!ast) {
+        stream = std::make_unique<TokenStream>(source);
+        Parcer parcer(*stream, arena);
+        parcer.set_lazy_bodies(true);
         parcer.parce();
-        std::cout << "парсер кон" << std::endl;
-        auto ast = parcer.getASTRoot();
+        ast = static_cast<ASTRootNode*>(parcer.getASTRoot());
+        resolver.set_lazy_bodies(*stream, arena);
+    }
+    Program program = resolver.resolve(*ast);
+    std::size_t removed = Folder(program, arena).fold(*ast);
+    if (backend == Backend::AST) {
+        EvalVisitor eval(program, std::cin, std::cout);
+        return eval.run(*ast);
+    }
+    Module module = compile(program, *ast);
+    if (backend == Backend::DISASM) {
+        std::cout << "свертка констант: убрано узлов " << removed << '\n';
+        disassemble(module, std::cout);
+        return 0;
+    }
+    VM vm(module, std::cin, std::cout);
+    return vm.run();
+}
 
-        std::cout << "__________________________" << std::endl;
-        PrintVisitor visitor;
-        ast->accept(visitor);
+// program [--tokens | --check | --run | --run-ast | --disasm] [--cache каталог] [файл...],
+// без файлов читается prg.txt
+int main(int argc, char* argv[]) {
+    bool dump_tokens = false;
+    bool check_only = false;
+    bool run_program = false;
+    Backend backend = Backend::VM;
+    std::unique_ptr<AstCache> cache;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tokens") dump_tokens = true;
+        else if (arg == "--check") check_only = true;
+        else if (arg == "--run") run_program = true;
+        else if (arg == "--run-ast") { run_program = true; backend = Backend::AST; }
+        else if (arg == "--disasm") { run_program = true; backend = Backend::DISASM; }
+        else if (arg == "--cache" && i + 1 < argc) cache = std::make_unique<AstCache>(argv[++i]);
+        else paths.push_back(arg);
+    }
+    if (paths.empty()) paths.push_back("prg.txt");
 
-    } catch (const std::runtime_error& e) {
-        std::cerr << "Ошибка: " << e.what() << std::endl;
+    auto sources = load_sources(paths);
+    int status = 0;
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        try {
+            auto source = sources[i].get();
+            if (check_only) {
+                if (!check(*source)) status = 1;
+                continue;
+            }
+            if (run_program) {
+                if (int code = execute(*source, cache.get(), backend)) status = code;
+                continue;
+            }
+            if (paths.size() > 1) std::cout << "== " << paths[i] << std::endl;
+            run(*source, dump_tokens, cache.get());
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            status = 1;
+        }
     }
 
-    return 0;
+    return status;
 }
@@ -1,35 +1,282 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <future>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
 #include "parcer.hpp"
 #include "ast.hpp"
 
-Parcer::Parcer(const std::vector<Token>& token_array) :
-    token_array(token_array) {}
+Parcer::Parcer(Lexer& lexer, AstArena& arena) :
+    source(lexer.getSource()), tokens(lexer), arena(arena) {}
 
-void Parcer::parce() {
-    root = std::make_shared<ASTRootNode>();
+Parcer::Parcer(const TokenStream& stream, AstArena& arena) :
+    source(stream.getSource()), stream(&stream), tokens(stream), arena(arena) {}
+
+Parcer::Parcer(const TokenStream& stream, std::size_t first, std::size_t last, AstArena& arena,
+               std::unordered_map<std::string_view, Symbol> names) :
+    source(stream.getSource()), stream(&stream), tokens(stream, first, last), arena(arena),
+    names(std::move(names)) {}
+
+void Parcer::parce(ParceMode mode) {
+    this->mode = mode;
     parcer_starter();
+    if (mode == ParceMode::STRICT && !diagnostics.empty())
+        throw std::runtime_error(describe(diagnostics.front()));
 }
 
-std::shared_ptr<ASTNode> Parcer::getASTRoot() const {
+ASTNode* Parcer::getASTRoot() const {
     return root;
 }
 
+const std::vector<Diagnostic>& Parcer::getDiagnostics() const {
+    return diagnostics;
+}
+
+std::string Parcer::describe(const Diagnostic& diagnostic) const {
+    std::string text = source.where(diagnostic.offset) + ": " + diagnostic.message;
+    if (diagnostic.expected != TokenType::ERROR)
+        text += " (ожидалось '" + std::string(tokenSpelling(diagnostic.expected)) + "')";
+    return text;
+}
+
+void Parcer::parce_parallel(std::size_t threads) {
+    // на маленьких входах запуск потоков дороже самого разбора
+    constexpr std::size_t MIN_TOKENS = 1 << 16;
+
+    if (!stream) return parce();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, stream->size() / MIN_TOKENS);
+    if (threads <= 1) return parce();
+
+    // куски режутся по началам объявлений, примерно поровну токенов на поток
+    std::vector<std::size_t> starts = declaration_starts();
+    std::size_t end = stream->size() - 1;
+    std::vector<std::size_t> bounds{0};
+    for (std::size_t i = 1; i < threads; ++i) {
+        auto it = std::lower_bound(starts.begin(), starts.end(), end * i / threads);
+        if (it != starts.end() && *it > bounds.back() && *it < end) bounds.push_back(*it);
+    }
+    bounds.push_back(end);
+
+    std::vector<AstArena*> arenas;
+    for (std::size_t i = 0; i + 1 < bounds.size(); ++i) arenas.push_back(&arena.fork());
+
+    struct Part {
+        std::pmr::vector<ASTNode*> statements;
+        std::vector<DeclRange> ranges;
+        bool ok;
+    };
+    std::vector<std::future<Part>> parts;
+    for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+        parts.push_back(std::async(std::launch::async, [this, &bounds, &arenas, i] {
+            Parcer part(*stream, bounds[i], bounds[i + 1], *arenas[i], names);
+            part.lazy_bodies = lazy_bodies;
+            std::pmr::vector<ASTNode*> statements(arenas[i]);
+            part.declarations(statements);
+            return Part{std::move(statements), std::move(part.ranges), part.diagnostics.empty()};
+        }));
+    }
+
+    std::pmr::vector<ASTNode*> statements(&arena);
+    ranges.clear();
+    bool ok = true;
+    for (auto& part : parts) {
+        Part result = part.get();
+        ok = ok && result.ok;
+        statements.insert(statements.end(), result.statements.begin(), result.statements.end());
+        ranges.insert(ranges.end(), result.ranges.begin(), result.ranges.end());
+    }
+
+    // ошибка в каком-то куске: весь файл разбирается заново последовательно,
+    // чтобы сообщение было ровно тем же, что и у parce()
+    if (!ok) return parce();
+    root = arena.make<ASTRootNode>(std::move(statements));
+}
+
+void Parcer::set_lazy_bodies(bool lazy) {
+    lazy_bodies = lazy && stream;
+}
+
+BlockStatmNode* Parcer::parce_body(const TokenStream& stream, AstArena& arena, FuncDeclNode& func) {
+    if (!func.pending()) return func.body;
+    Parcer part(stream, func.body_first, func.body_last, arena, {});
+    auto body = part.block_statement();
+    if (body && !part.check(TokenType::END_OF_FILE))
+        body = part.report("Лишние токены после тела функции");
+    if (!body)
+        throw std::runtime_error(part.describe(part.diagnostics.front()));
+    func.body = static_cast<BlockStatmNode*>(*body);
+    return func.body;
+}
+
+// пропуск тела функции по парным скобкам: смотрим только байты видов токенов
+// в TokenStream и переставляем окно сразу за закрывающую '}'
+bool Parcer::skip_block() {
+    std::size_t depth = 0;
+    std::size_t end = stream->size() - 1;
+    for (std::size_t i = tokens.position(); i < end; ++i) {
+        auto type = stream->type(i);
+        if (type == TokenType::LBRACE) {
+            ++depth;
+        } else if (type == TokenType::RBRACE && --depth == 0) {
+            tokens.seek(i + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// один проход по видам токенов: объявление кончается на ';' вне скобок или на '}',
+// закрывающей тело функции (блок сразу после ')'). заодно имена регистрируются
+// в порядке текста - тогда номера символов не зависят от того, какой поток успел первым.
+// неверный вход здесь не ищется: куски с ним не разберутся, и parce_parallel
+// повторит разбор целиком
+std::vector<std::size_t> Parcer::declaration_starts() {
+    std::vector<std::size_t> starts;
+    std::size_t depth = 0;
+    bool body = false;
+    bool open = false;      // начало следующего объявления еще не записано
+    for (std::size_t i = 0; i + 1 < stream->size(); ++i) {
+        auto type = stream->type(i);
+        if (!open) {
+            starts.push_back(i);
+            open = true;
+        }
+        switch (type) {
+            case TokenType::ID:
+            case TokenType::KW_INT:
+            case TokenType::KW_FLOAT:
+            case TokenType::KW_CHAR:
+            case TokenType::KW_BOOL:
+            case TokenType::KW_VOID:
+                intern((*stream)[i].value);
+                break;
+            case TokenType::LBRACE:
+                if (depth == 0 && i > 0 && stream->type(i - 1) == TokenType::RPAREN) body = true;
+                ++depth;
+                break;
+            case TokenType::LPAREN:
+            case TokenType::LBRACKET:
+                ++depth;
+                break;
+            case TokenType::RBRACE:
+            case TokenType::RPAREN:
+            case TokenType::RBRACKET:
+                if (depth > 0) --depth;
+                if (depth == 0 && body && type == TokenType::RBRACE) {
+                    body = false;
+                    open = false;
+                }
+                break;
+            case TokenType::SEMICOLON:
+                if (depth == 0) open = false;
+                break;
+            default:
+                break;
+        }
+    }
+    return starts;
+}
+
 void Parcer::parcer_starter() {
+    std::pmr::vector<ASTNode*> statements(&arena);
+    ranges.clear();
+    declarations(statements);
+    root = arena.make<ASTRootNode>(std::move(statements));
+}
+
+void Parcer::declarations(std::pmr::vector<ASTNode*>& statements) {
+    while (!check(TokenType::END_OF_FILE) && next_declaration(statements)) {}
+}
+
+bool Parcer::next_declaration(std::pmr::vector<ASTNode*>& statements) {
+    auto start = tokens.position();
+    auto decl = declaration();
+    if (decl) {
+        statements.push_back(*decl);
+        ranges.push_back({static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(tokens.position())});
+    } else if (mode == ParceMode::RECOVER) {
+        synchronize(start, false);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// объявление зависит только от своих токенов и от LOOKAHEAD токенов за ним, поэтому
+// целиком лежащие до правки берутся без изменений, а после нее - как только разбор
+// дошел ровно до начала одного из них (в новой нумерации). если правка сломала границу
+// (например, удалена '}'), разбор идет дальше, пока снова не совпадет, или до конца
+void Parcer::reparce(const Parcer& previous, const Lexer::TokenRange& change, ParceMode mode) {
+    if (!stream || !previous.root || previous.ranges.size() != previous.root->statements.size())
+        return parce(mode);
+    this->mode = mode;
+    const auto& old = previous.root->statements;
+    const auto& old_ranges = previous.ranges;
+    std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(change.new_end) - static_cast<std::ptrdiff_t>(change.old_end);
+
+    std::pmr::vector<ASTNode*> statements(&arena);
+    ranges.clear();
+    std::size_t i = 0;
+    while (i < old.size() && old_ranges[i].last + TokenBuffer::LOOKAHEAD <= change.first) {
+        statements.push_back(old[i]);
+        ranges.push_back(old_ranges[i]);
+        ++i;
+    }
+    std::size_t restart = i == 0 ? 0 : old_ranges[i - 1].last;
+    tokens.seek(restart);
+    // ошибки RECOVER из взятых кусков переносятся, из разбираемого заново - появятся снова
+    for (const auto& diagnostic : previous.diagnostics)
+        if (diagnostic.token < restart) diagnostics.push_back(diagnostic);
+
+    std::size_t j = i;
+    while (j < old.size() && old_ranges[j].first < change.old_end) ++j;
     while (!check(TokenType::END_OF_FILE)) {
-        root->statements.push_back(declaration());
+        std::size_t position = tokens.position();
+        while (j < old.size() && old_ranges[j].first + shift < static_cast<std::ptrdiff_t>(position)) ++j;
+        if (j < old.size() && old_ranges[j].first + shift == static_cast<std::ptrdiff_t>(position)) {
+            std::ptrdiff_t bytes = static_cast<std::ptrdiff_t>(source.size()) - static_cast<std::ptrdiff_t>(previous.source.size());
+            for (const auto& diagnostic : previous.diagnostics) {
+                // на первом токене объявления может стоять только ошибка прошлой, заново разобранной попытки
+                if (diagnostic.token <= old_ranges[j].first) continue;
+                diagnostics.push_back({diagnostic.token + shift, diagnostic.offset + bytes,
+                                       diagnostic.expected, diagnostic.message});
+            }
+            for (; j < old.size(); ++j) {
+                ASTNode* decl = old[j];
+                // у отложенного тела номера токенов старые: узел копируется, старое дерево не трогаем
+                auto* func = decl->kind == NodeKind::FUNC_DECL ? static_cast<FuncDeclNode*>(decl) : nullptr;
+                if (func && func->pending() && shift != 0) {
+                    std::pmr::vector<std::pair<Symbol, Symbol>> parameters(func->parameters, &arena);
+                    auto* moved = arena.make<FuncDeclNode>(func->func_type, func->func_name, std::move(parameters));
+                    moved->body_first = static_cast<std::uint32_t>(func->body_first + shift);
+                    moved->body_last = static_cast<std::uint32_t>(func->body_last + shift);
+                    decl = moved;
+                }
+                statements.push_back(decl);
+                ranges.push_back({static_cast<std::uint32_t>(old_ranges[j].first + shift),
+                                  static_cast<std::uint32_t>(old_ranges[j].last + shift)});
+            }
+            break;
+        }
+        if (!next_declaration(statements)) break;
     }
+    root = arena.make<ASTRootNode>(std::move(statements));
+    if (mode == ParceMode::STRICT && !diagnostics.empty())
+        throw std::runtime_error(describe(diagnostics.front()));
 }
 
-bool Parcer::check(TokenType type) const {
-    return index < token_array.size() && token_array[index].type == type;
+bool Parcer::check(TokenType type) {
+    return tokens.peek().type == type;
 }
 
 void Parcer::advance() {
-    if (index < token_array.size())
-        index++;
+    tokens.advance();
 }
 
 bool Parcer::check_advance(TokenType type) {
@@ -40,11 +287,80 @@ bool Parcer::check_advance(TokenType type) {
     return false;
 }
 
-Token Parcer::peek() const {
-    return token_array[index];
+const Token& Parcer::peek(std::size_t offset) {
+    return tokens.peek(offset);
+}
+
+Symbol Parcer::symbol() {
+    Symbol result = intern(peek().value);
+    advance();
+    return result;
 }
 
-std::shared_ptr<DeclNode> Parcer::declaration() {
+Symbol Parcer::intern(std::string_view text) {
+    // свой кэш без блокировок: большинство имён в файле повторяются
+    auto [it, inserted] = names.try_emplace(text, 0);
+    if (inserted) it->second = symbols::intern(text);
+    return it->second;
+}
+
+const Token& Parcer::previous() const {
+    return tokens.previous();
+}
+
+// позиция берется из текущего токена: его текст - вид в исходный буфер
+std::unexpected<Parcer::Failed> Parcer::report(const std::string& message, TokenType expected) {
+    diagnostics.push_back({tokens.position(), source.offset_of(peek().value), expected, message});
+    return std::unexpected(Failed{});
+}
+
+// после ошибки пропускаем токены до ';' (включительно), до '}' или до начала объявления.
+// пропущенные блоки { ... } проходятся целиком. '}' закрывает объемлющий блок, поэтому
+// внутри блока на нем останавливаемся, а на верхнем уровне он лишний и пропускается.
+// если ошибка случилась на первом же токене конструкции, он пропускается в любом случае
+void Parcer::synchronize(std::size_t start, bool nested) {
+    std::size_t depth = 0;
+    if (tokens.position() == start) {
+        if (check(TokenType::LBRACE)) ++depth;
+        else if (check(TokenType::RBRACE) && nested) return; // блок закроется сам
+        advance();
+    }
+    while (!check(TokenType::END_OF_FILE)) {
+        if (depth == 0 && previous().type == TokenType::SEMICOLON) return;
+        switch (peek().type) {
+            case TokenType::LBRACE:
+                ++depth;
+                break;
+            case TokenType::RBRACE:
+                if (depth == 0) {
+                    if (nested) return;
+                    break;      // лишняя '}' на верхнем уровне - пропускаем, как и ';' за ней
+                }
+                if (--depth == 0) {
+                    advance();
+                    return;
+                }
+                break;
+            case TokenType::KW_INT:
+            case TokenType::KW_FLOAT:
+            case TokenType::KW_CHAR:
+            case TokenType::KW_BOOL:
+            case TokenType::KW_VOID:
+            case TokenType::KW_STRUCT:
+            case TokenType::KW_ASSERT:
+            case TokenType::KW_CONST:
+                if (depth == 0) return;
+                break;
+            default:
+                break;
+        }
+        advance();
+    }
+}
+
+Parcer::Parced<DeclNode*> Parcer::declaration() {
+    if (check(TokenType::KW_CONST))
+        return variable_declaration();
     if (
         check(TokenType::KW_INT) ||
         check(TokenType::KW_FLOAT) ||
@@ -53,7 +369,7 @@ std::shared_ptr<DeclNode> Parcer::declaration() {
         check(TokenType::ID) ||
         check(TokenType::KW_VOID) /*check(SEMICOLON)*/
     ) {
-        if (token_array[index + 2].type == TokenType::LPAREN)
+        if (peek(2).type == TokenType::LPAREN)
             return function_declaration();       // вызвать функцию которая парсит и у функции и у переменной
         else
             return variable_declaration();
@@ -62,119 +378,136 @@ std::shared_ptr<DeclNode> Parcer::declaration() {
         return struct_declaration();
     else if (check_advance(TokenType::KW_ASSERT))
         return assert_declaration();
-    else 
-        throw std::runtime_error("Неверный токен в декларации: " + token_array[index].value);
+    else
+        return report("Неверный токен в декларации: " + std::string(peek().value));
 }
 
-std::shared_ptr<DeclNode> Parcer::variable_declaration() {
+Parcer::Parced<DeclNode*> Parcer::variable_declaration() {
     if (check_advance(TokenType::SEMICOLON)) // вот это убрать
         return nullptr;
 
-    auto type = peek().value;
-    advance();
+    bool constant = check_advance(TokenType::KW_CONST);
+    auto type = symbol();
 
-    std::vector<VariableNode> variables;
+    std::pmr::vector<VariableNode> variables(&arena);
 
     do {
-        auto name = peek().value;
-        advance();
-        std::shared_ptr<ExprNode> init = nullptr;
-        std::shared_ptr<ExprNode> size = nullptr;
+        if (!check(TokenType::ID))
+            return report("Ожидалось имя переменной", TokenType::ID);
+        auto name = symbol();
+        ExprNode* init = nullptr;
+        ExprNode* size = nullptr;
 
         if (check_advance(TokenType::LBRACKET)) {
             if (!check(TokenType::RBRACKET)){
-                size = expression();
+                auto parced = expression();
+                if (!parced) return failed;
+                size = *parced;
             }
             if (!check_advance(TokenType::RBRACKET))
-                throw std::runtime_error("Не закрыта квадратная скобка после объявления размера массива");
+                return report("Не закрыта квадратная скобка после объявления размера массива", TokenType::RBRACKET);
         }
         if (check_advance(TokenType::ASSIGN) /*|| check(TokenType::LBRACE) убрать нахуй*/) {
-            if (check(TokenType::LBRACE)) init = array_initialization_expression();
-            else init = expression();
+            auto parced = check(TokenType::LBRACE) ? array_initialization_expression() : expression(COMMA);
+            if (!parced) return failed;
+            init = *parced;
         }
         variables.emplace_back(name, init, size);
     } while (check_advance(TokenType::COMMA));
 
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Пропущена точка с запятой [1]");
+        return report("Пропущена точка с запятой [1]", TokenType::SEMICOLON);
 
-    return std::make_shared<VarDeclNode>(type, variables);
+    return arena.make<VarDeclNode>(type, std::move(variables), constant);
 
 }
 
-std::shared_ptr<FuncDeclNode> Parcer::function_declaration() {
-    auto func_type = peek().value;
-    advance();
-    auto func_name = peek().value;
-    advance();
+Parcer::Parced<FuncDeclNode*> Parcer::function_declaration() {
+    auto func_type = symbol();
+    auto func_name = symbol();
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Пропущена открывающаяся скобка для параметров ф-ции");
-    
-    std::vector<std::pair<std::string, std::string>> parameters;
-    while (!check(TokenType::RPAREN)) {  // стоит перекинуть  в отдель ную функцию
-        auto type = peek().value;
-        advance();
-        auto name = peek().value;
-        advance();
+        return report("Пропущена открывающаяся скобка для параметров ф-ции", TokenType::LPAREN);
+
+    std::pmr::vector<std::pair<Symbol, Symbol>> parameters(&arena);
+    while (!check(TokenType::RPAREN) && !check(TokenType::END_OF_FILE)) {  // стоит перекинуть  в отдель ную функцию
+        auto type = symbol();
+        if (!check(TokenType::ID))
+            return report("Ожидалось имя параметра", TokenType::ID);
+        auto name = symbol();
         parameters.emplace_back(type, name);
-        if (!check(TokenType::RPAREN)) 
+        if (!check(TokenType::RPAREN))
             if (!check_advance(TokenType::COMMA))
-                throw std::runtime_error("Пропущена запятая между параметрами");
+                return report("Пропущена запятая между параметрами", TokenType::COMMA);
     }
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Пропущена закрывающая скобка для параметров ф-ции");
-    
+        return report("Пропущена закрывающая скобка для параметров ф-ции", TokenType::RPAREN);
+
     if (check_advance(TokenType::SEMICOLON))
-        return std::make_shared<FuncDeclNode>(func_type, func_name, parameters, nullptr);
-    
-    auto body = std::dynamic_pointer_cast<BlockStatmNode>(block_statement());
-    return std::make_shared<FuncDeclNode>(func_type, func_name, parameters, body);
+        return arena.make<FuncDeclNode>(func_type, func_name, std::move(parameters), nullptr);
+
+    if (lazy_bodies && check(TokenType::LBRACE)) {
+        auto first = tokens.position();
+        if (!skip_block()) {
+            tokens.seek(stream->size() - 1);
+            return report("ожидалось закрытие фигурной скобки", TokenType::RBRACE);
+        }
+        auto func = arena.make<FuncDeclNode>(func_type, func_name, std::move(parameters), nullptr);
+        func->body_first = static_cast<std::uint32_t>(first);
+        func->body_last = static_cast<std::uint32_t>(tokens.position());
+        return func;
+    }
+
+    auto body = block_statement();
+    if (!body) return failed;
+    return arena.make<FuncDeclNode>(func_type, func_name, std::move(parameters), static_cast<BlockStatmNode*>(*body));
 }
 
-std::shared_ptr<DeclNode> Parcer::struct_declaration() {
-    auto name = peek().value;
-    advance();
+Parcer::Parced<DeclNode*> Parcer::struct_declaration() {
+    auto name = symbol();
     if (!check_advance(TokenType::LBRACE))
-        throw std::runtime_error("Не открыты фигурные скобки для структуры");
-    
-    std::vector<VarDeclNode> fields;
-    while (!check(TokenType::RBRACE)) {
-        fields.push_back(*std::dynamic_pointer_cast<VarDeclNode>(variable_declaration()));
+        return report("Не открыты фигурные скобки для структуры", TokenType::LBRACE);
+
+    std::pmr::vector<VarDeclNode*> fields(&arena);
+    while (!check(TokenType::RBRACE) && !check(TokenType::END_OF_FILE)) {
+        auto field = variable_declaration();
+        if (!field) return failed;
+        fields.push_back(static_cast<VarDeclNode*>(*field));
     }
 
     if (!check_advance(TokenType::RBRACE))
-        throw std::runtime_error("Не закрыты фигурные скобки структуры");
+        return report("Не закрыты фигурные скобки структуры", TokenType::RBRACE);
 
     if (!check_advance(TokenType::SEMICOLON)) // по идее не нужна
-        throw std::runtime_error("Пропущена точка с запятой после объявления структуры [2]");
-    return std::make_shared<StructDeclNode>(name, fields);
+        return report("Пропущена точка с запятой после объявления структуры [2]", TokenType::SEMICOLON);
+    return arena.make<StructDeclNode>(name, std::move(fields));
 }
 
-std::shared_ptr<DeclNode> Parcer::assert_declaration() {
+Parcer::Parced<DeclNode*> Parcer::assert_declaration() {
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("нужны скобочки для ассерта");
+        return report("нужны скобочки для ассерта", TokenType::LPAREN);
 
-    auto expr = expression();
-    std::string message = "";
+    auto expr = expression(COMMA);  // запятая отделяет сообщение, а не оператор
+    if (!expr) return failed;
+    std::string_view message;
 
     if (check_advance(TokenType::COMMA)) {
         if (!check(TokenType::STR_LIT)) {
-            throw std::runtime_error("после запятой в ассерте ожидается строка");
+            return report("после запятой в ассерте ожидается строка", TokenType::STR_LIT);
         }
-        auto message = peek().value;
+        message = peek().value;
         advance();
     }
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Ожидалось закрытие скобочек)))");
-    
+        return report("Ожидалось закрытие скобочек)))", TokenType::RPAREN);
+
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой после ассерта [3]");
+        return report("Ожидалась точка с запятой после ассерта [3]", TokenType::SEMICOLON);
 
-    return std::make_shared<AssertDeclNode>(expr, message);
+    return arena.make<AssertDeclNode>(*expr, message);
 }
 
 
-std::shared_ptr<StatmNode> Parcer::statement() {
+Parcer::Parced<StatmNode*> Parcer::statement() {
     if (check_advance(TokenType::KW_IF)) return conditional_statement();
     if (check_advance(TokenType::KW_WHILE)) return while_statement();
     if (check_advance(TokenType::KW_DO)) return dowhile_statement();
@@ -187,340 +520,432 @@ std::shared_ptr<StatmNode> Parcer::statement() {
     if (check_advance(TokenType::KW_READ)) return in_statement();
     if (check_advance(TokenType::KW_SIZEOF)) return sizeof_statement(); // его тогда не сюда
     if (check(TokenType::LBRACE)) return block_statement();
-    if ((check(TokenType::KW_INT) || check(TokenType::KW_FLOAT) ||
+    if ((check(TokenType::KW_CONST) || check(TokenType::KW_INT) || check(TokenType::KW_FLOAT) ||
         check(TokenType::KW_CHAR) || check(TokenType::KW_BOOL) ||
-        check(TokenType::ID) && token_array[index + 1].type == TokenType::ID)) {
-        return std::make_shared<ExprStatmNode>(variable_declaration());
+        (check(TokenType::ID) && peek(1).type == TokenType::ID))) {
+        auto decl = variable_declaration();
+        if (!decl) return failed;
+        return arena.make<ExprStatmNode>(*decl);
     }
     return expression_statement();
 }
 
-std::shared_ptr<StatmNode> Parcer::expression_statement() {
+Parcer::Parced<StatmNode*> Parcer::expression_statement() {
     if (check_advance(TokenType::SEMICOLON)) {
         return nullptr;
     }
     auto expr = expression();
-
-    // тут тоже добавить проверку на тточку с запятой
-
-    return std::make_shared<ExprStatmNode>(expr);
+    if (!expr) return failed;
+    if (!check_advance(TokenType::SEMICOLON))
+        return report("Ожидалась точка с запятой после выражения [4]", TokenType::SEMICOLON);
+    return arena.make<ExprStatmNode>(*expr);
 }
 
-// заменит на хэкспект выволфы ошибок
-
-std::shared_ptr<StatmNode> Parcer::conditional_statement() {
-    if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалась скобка после условного оператора");
-    auto condition = expression();
-    if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Ожидалось закрытие скобки после условия");
-    auto then_statm = statement();
-    std::shared_ptr<StatmNode> else_statm = nullptr;
-    if (check_advance(TokenType::KW_ELSE)) else_statm = statement();
-    return std::make_shared<ConditionStatmNode>(condition, then_statm, else_statm);
+// цепочка else if разбирается циклом: каждая ветка дописывается в else предыдущей,
+// так что тысячи веток не растят стек
+Parcer::Parced<StatmNode*> Parcer::conditional_statement() {
+    ConditionStatmNode* first = nullptr;
+    ConditionStatmNode* last = nullptr;
+    while (true) {
+        if (!check_advance(TokenType::LPAREN))
+            return report("Ожидалась скобка после условного оператора", TokenType::LPAREN);
+        auto condition = expression();
+        if (!condition) return failed;
+        if (!check_advance(TokenType::RPAREN))
+            return report("Ожидалось закрытие скобки после условия", TokenType::RPAREN);
+        auto then_statm = statement();
+        if (!then_statm) return failed;
+        auto* branch = arena.make<ConditionStatmNode>(*condition, *then_statm);
+        if (last) last->else_statm = branch;
+        else first = branch;
+        last = branch;
+
+        if (!check_advance(TokenType::KW_ELSE)) return first;
+        if (check_advance(TokenType::KW_IF)) continue;
+        auto parced = statement();
+        if (!parced) return failed;
+        last->else_statm = *parced;
+        return first;
+    }
 }
 
-std::shared_ptr<StatmNode> Parcer::while_statement() {
+Parcer::Parced<StatmNode*> Parcer::while_statement() {
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки для условия цикла");
+        return report("Ожидалось открытие скобки для условия цикла", TokenType::LPAREN);
     auto condition = expression();
+    if (!condition) return failed;
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Ожидалось закрытие скобки после условия");
+        return report("Ожидалось закрытие скобки после условия", TokenType::RPAREN);
     auto body = statement();
-    return std::make_shared<WhileStatmNode>(condition, body);
+    if (!body) return failed;
+    return arena.make<WhileStatmNode>(*condition, *body);
 }
 
-std::shared_ptr<StatmNode> Parcer::dowhile_statement() {
+Parcer::Parced<StatmNode*> Parcer::dowhile_statement() {
     auto body = statement();
+    if (!body) return failed;
     if (!check_advance(TokenType::KW_WHILE))
-        throw std::runtime_error("Ожидалось 'пока' после 'делай'");
+        return report("Ожидалось 'пока' после 'делай'", TokenType::KW_WHILE);
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки для условия цикла");
+        return report("Ожидалось открытие скобки для условия цикла", TokenType::LPAREN);
     auto condition = expression();
+    if (!condition) return failed;
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Ожидалось закрытие скобки после условия");
-
-    // проверка на ;
-    return std::make_shared<WhileStatmNode>(condition, body);
+        return report("Ожидалось закрытие скобки после условия", TokenType::RPAREN);
+    if (!check_advance(TokenType::SEMICOLON))
+        return report("Ожидалась точка с запятой после do-while [7]", TokenType::SEMICOLON);
+    return arena.make<WhileStatmNode>(*condition, *body, true);
 }
 
-std::shared_ptr<StatmNode> Parcer::for_statement() { // переделать потому что не только инит
+Parcer::Parced<StatmNode*> Parcer::for_statement() {
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки для условия цикла");
-    std::shared_ptr<DeclNode> init = nullptr;
+        return report("Ожидалось открытие скобки для условия цикла", TokenType::LPAREN);
+    ASTNode* init = nullptr;
     if (!check(TokenType::SEMICOLON)) {
-        if (check(TokenType::KW_INT) || check(TokenType::KW_FLOAT) ||
+        if (check(TokenType::KW_CONST) || check(TokenType::KW_INT) || check(TokenType::KW_FLOAT) ||
             check(TokenType::KW_CHAR) || check(TokenType::KW_BOOL)) {
-            init = variable_declaration();
+            auto decl = variable_declaration();
+            if (!decl) return failed;
+            init = *decl;
         } else {
-            init = std::dynamic_pointer_cast<DeclNode>(expression());
+            auto expr = expression();
+            if (!expr) return failed;
+            init = *expr;
             if (!check_advance(TokenType::SEMICOLON))
-                throw std::runtime_error("Ожидалась точка с запятой после инициализации [5]");
+                return report("Ожидалась точка с запятой после инициализации [5]", TokenType::SEMICOLON);
         }
+    } else {
+        advance();
+    }
+    ExprNode* condition = nullptr;
+    if (!check(TokenType::SEMICOLON)) {
+        auto parced = expression();
+        if (!parced) return failed;
+        condition = *parced;
     }
-    auto condition = check(TokenType::SEMICOLON) ? nullptr : expression();
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой после условия [6]");
-    auto incr = check(TokenType::RPAREN) ? nullptr : expression();
+        return report("Ожидалась точка с запятой после условия [6]", TokenType::SEMICOLON);
+    ExprNode* incr = nullptr;
+    if (!check(TokenType::RPAREN)) {
+        auto parced = expression();
+        if (!parced) return failed;
+        incr = *parced;
+    }
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Ожидалось закрытие скобки после цикла фор");
+        return report("Ожидалось закрытие скобки после цикла фор", TokenType::RPAREN);
     auto body = statement();
-    return std::make_shared<ForStatmNode>(init, condition, incr, body);
+    if (!body) return failed;
+    return arena.make<ForStatmNode>(init, condition, incr, *body);
 }
 
-std::shared_ptr<StatmNode> Parcer::return_statement() {
-    std::shared_ptr<StatmNode> expr = nullptr;
-    if (!check(TokenType::SEMICOLON))
-        expr = statement();
-    return std::make_shared<ReturnStatmNode>(expr);
+Parcer::Parced<StatmNode*> Parcer::return_statement() {
+    StatmNode* expr = nullptr;
+    if (!check_advance(TokenType::SEMICOLON)) {
+        auto parced = statement();
+        if (!parced) return failed;
+        expr = *parced;
+    }
+    return arena.make<ReturnStatmNode>(expr);
 }
 
-std::shared_ptr<StatmNode> Parcer::break_statement() {
+Parcer::Parced<StatmNode*> Parcer::break_statement() {
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой [9]");
-    return std::make_shared<BreakStatmNode>();
+        return report("Ожидалась точка с запятой [9]", TokenType::SEMICOLON);
+    return arena.make<BreakStatmNode>();
 }
-std::shared_ptr<StatmNode> Parcer::continue_statement() {
+Parcer::Parced<StatmNode*> Parcer::continue_statement() {
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой [10]");
-    return std::make_shared<ContinueStatmNode>();
+        return report("Ожидалась точка с запятой [10]", TokenType::SEMICOLON);
+    return arena.make<ContinueStatmNode>();
 }
 
-std::shared_ptr<StatmNode> Parcer::exit_statement() {
+Parcer::Parced<StatmNode*> Parcer::exit_statement() {
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки");
+        return report("Ожидалось открытие скобки", TokenType::LPAREN);
     auto expr = expression();
+    if (!expr) return failed;
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("Ожидалось закрытие скобки");
+        return report("Ожидалось закрытие скобки", TokenType::RPAREN);
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой [11]");
-    return std::make_shared<ExitStatmNode>(expr);
+        return report("Ожидалась точка с запятой [11]", TokenType::SEMICOLON);
+    return arena.make<ExitStatmNode>(*expr);
 }
 
-std::shared_ptr<StatmNode> Parcer::out_statement() {
-    auto type = token_array[index - 1].type;
-    std::shared_ptr<StatmNode> expr = nullptr;
+Parcer::Parced<StatmNode*> Parcer::out_statement() {
+    auto type = previous().type;
+    StatmNode* expr = nullptr;
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки");
-    if (type == TokenType::KW_PRINT)
-        expr = statement();
-    
+        return report("Ожидалось открытие скобки", TokenType::LPAREN);
+    if (type == TokenType::KW_PRINT) {
+        auto parced = expression();
+        if (!parced) return failed;
+        expr = arena.make<ExprStatmNode>(*parced);
+    }
+
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("ожидалось закрытие скобки1");
+        return report("ожидалось закрытие скобки1", TokenType::RPAREN);
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой [11]");
+        return report("Ожидалась точка с запятой [11]", TokenType::SEMICOLON);
 
-    return std::make_shared<OutStatmNode>(expr);
+    return arena.make<OutStatmNode>(expr);
 }
 
-std::shared_ptr<StatmNode> Parcer::in_statement() {
-    auto type = token_array[index - 1].type;
-    std::shared_ptr<StatmNode> expr = nullptr;
+Parcer::Parced<StatmNode*> Parcer::in_statement() {
+    auto type = previous().type;
+    StatmNode* expr = nullptr;
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки");
+        return report("Ожидалось открытие скобки", TokenType::LPAREN);
     if (type == TokenType::KW_READ){
-        expr = statement();
+        auto parced = expression();
+        if (!parced) return failed;
+        expr = arena.make<ExprStatmNode>(*parced);
     }
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("ожидалось закрытие скобки2");
+        return report("ожидалось закрытие скобки2", TokenType::RPAREN);
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой [11]");
+        return report("Ожидалась точка с запятой [11]", TokenType::SEMICOLON);
 
-    return std::make_shared<InputStatmNode>(expr);
+    return arena.make<InputStatmNode>(expr);
 }
 
-std::shared_ptr<StatmNode> Parcer::sizeof_statement() {
-    auto type = token_array[index - 1].type;
-    std::shared_ptr<ExprNode> expr = nullptr;
+Parcer::Parced<StatmNode*> Parcer::sizeof_statement() {
+    auto type = previous().type;
+    ExprNode* expr = nullptr;
     if (!check_advance(TokenType::LPAREN))
-        throw std::runtime_error("Ожидалось открытие скобки");
-    if (type == TokenType::KW_SIZEOF)
-        expr = expression();
+        return report("Ожидалось открытие скобки", TokenType::LPAREN);
+    if (type == TokenType::KW_SIZEOF) {
+        auto parced = expression();
+        if (!parced) return failed;
+        expr = *parced;
+    }
     if (!check_advance(TokenType::RPAREN))
-        throw std::runtime_error("ожидалось закрытие скобки3");
+        return report("ожидалось закрытие скобки3", TokenType::RPAREN);
     if (!check_advance(TokenType::SEMICOLON))
-        throw std::runtime_error("Ожидалась точка с запятой [12.5]");
+        return report("Ожидалась точка с запятой [12.5]", TokenType::SEMICOLON);
 
-    return std::make_shared<SZFStatmNode>(expr);
+    return arena.make<SZFStatmNode>(expr);
 }
 
-std::shared_ptr<StatmNode> Parcer::block_statement() {
+// в режиме восстановления испорченная инструкция пропускается, блок разбирается дальше
+Parcer::Parced<StatmNode*> Parcer::block_statement() {
     if (!check_advance(TokenType::LBRACE))
-        throw std::runtime_error("Ожидалась фигурная скобка");
-    auto body = std::make_shared<BlockStatmNode>();
+        return report("Ожидалась фигурная скобка", TokenType::LBRACE);
+    std::pmr::vector<StatmNode*> statements(&arena);
     while (!check(TokenType::RBRACE) && !check(TokenType::END_OF_FILE)) {
-        body -> statements.push_back(statement());
+        auto start = tokens.position();
+        auto statm = statement();
+        if (statm) {
+            statements.push_back(*statm);
+        } else if (mode == ParceMode::RECOVER) {
+            synchronize(start, true);
+        } else {
+            return failed;
+        }
     }
     if (!check_advance(TokenType::RBRACE))
-        throw std::runtime_error("ожидалось закрытие фигурной скобки");
-    return body;
-}
-
-
-std::shared_ptr<ExprNode> Parcer::expression() {
-    auto expr = assign_expression();
-    while (check_advance(TokenType::COMMA)) {
-        auto next = assign_expression();
-        expr = std::make_shared<BinaryExprNode>(",", expr, next);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::assign_expression() {
-    auto expr = ternary_expression();
-    if (check_advance(TokenType::ASSIGN)) {
-        auto value = assign_expression();
-        return std::make_shared<AssignExprNode>(expr, value);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::ternary_expression() {
-    auto condition = or_expression();
-    if (check_advance(TokenType::QMARK)) {
-        auto true_expr = expression();
-        if (!check_advance(TokenType::COLON))
-            throw std::runtime_error("Ожидалось двоеточие");
-        auto false_expr = expression();
-        return std::make_shared<TernaryExprNode>(condition, true_expr, false_expr);
-    }
-    return condition;
-}
-
-std::shared_ptr<ExprNode> Parcer::or_expression() {
-    auto expr = and_expression();
-    while (check_advance(TokenType::OR)) {
-        auto oper2 = and_expression();
-        expr = std::make_shared<BinaryExprNode>("||", expr, oper2);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::and_expression() {
-    auto expr = equality_expression();
-    while (check_advance(TokenType::AND)) {
-        auto oper2 = equality_expression();
-        expr = std::make_shared<BinaryExprNode>("&&", expr, oper2);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::equality_expression() {
-    auto expr = comparison_expression();
-    while (check_advance(TokenType::EQ) || check_advance(TokenType::NEQ)) {
-        auto oper = token_array[index - 1].value;
-        auto operand2 = comparison_expression();
-        expr = std::make_shared<BinaryExprNode>(oper, expr, operand2);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::comparison_expression() {
-    auto expr = term_expression();
-    while (check_advance(TokenType::LT) || check_advance(TokenType::GT) || check_advance(TokenType::LEQ) || check_advance(TokenType::GEQ)) {
-        auto oper = token_array[index - 1].value;
-        auto operand2 = term_expression();
-        expr = std::make_shared<BinaryExprNode>(oper, expr, operand2);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::term_expression() {
-    auto expr = factor_expression();
-    while (check_advance(TokenType::PLUS) || check_advance(TokenType::MINUS)) {
-        auto oper = token_array[index - 1].value;
-        auto operand2 = factor_expression();
-        expr = std::make_shared<BinaryExprNode>(oper, expr, operand2);
-    }
-    return expr;
-}
-
-std::shared_ptr<ExprNode> Parcer::factor_expression() {
-    auto expr = unary_expression();
-    while (check_advance(TokenType::STAR) || check_advance(TokenType::SLASH) || check_advance(TokenType::PERCENT)) {
-        auto oper = token_array[index - 1].value;
-        auto operand2 = unary_expression();
-        expr = std::make_shared<BinaryExprNode>(oper, expr, operand2);
-    }
-    return expr;
-}
+        return report("ожидалось закрытие фигурной скобки", TokenType::RBRACE);
+    return arena.make<BlockStatmNode>(std::move(statements));
+}
+
+
+namespace {
+
+// сила связывания операторов после операнда (инфиксных и постфиксных) по TokenType;
+// 0 - токен выражение не продолжает
+constexpr auto binding_power = [] {
+    std::array<std::uint8_t, static_cast<std::size_t>(TokenType::ESCLIT) + 1> t{};
+    auto set = [&t](std::uint8_t power, std::initializer_list<TokenType> types) {
+        for (auto type : types) t[static_cast<std::size_t>(type)] = power;
+    };
+    set(Parcer::COMMA, {TokenType::COMMA});
+    set(Parcer::ASSIGNMENT, {TokenType::ASSIGN, TokenType::PLUS_ASSIGN, TokenType::MINUS_ASSIGN,
+                             TokenType::STAR_ASSIGN, TokenType::SLASH_ASSIGN, TokenType::PERCENT_ASSIGN});
+    set(Parcer::TERNARY, {TokenType::QMARK});
+    set(Parcer::LOGIC_OR, {TokenType::OR});
+    set(Parcer::LOGIC_AND, {TokenType::AND});
+    set(Parcer::BIT_OR, {TokenType::BIT_OR});
+    set(Parcer::BIT_XOR, {TokenType::BIT_XOR});
+    set(Parcer::BIT_AND, {TokenType::BIT_AND});
+    set(Parcer::EQUALITY, {TokenType::EQ, TokenType::NEQ});
+    set(Parcer::COMPARISON, {TokenType::LT, TokenType::GT, TokenType::LEQ, TokenType::GEQ});
+    set(Parcer::SHIFT, {TokenType::BIT_SHL, TokenType::BIT_SHR});
+    set(Parcer::TERM, {TokenType::PLUS, TokenType::MINUS});
+    set(Parcer::FACTOR, {TokenType::STAR, TokenType::SLASH, TokenType::PERCENT});
+    set(Parcer::POSTFIX, {TokenType::INCREMENT, TokenType::DECREMENT, TokenType::LBRACKET,
+                          TokenType::LPAREN, TokenType::DOT});
+    return t;
+}();
+
+}
+
+// разбор Пратта: операнд, затем операторы, которые связывают сильнее min_power.
+// левоассоциативные берут правый операнд с той же силой, а присваивание и ?: - любое
+// выражение без запятой, так что a = b = c и a ? b : c ? d : e группируются справа.
+// вместо рекурсии за правым операндом каждый ждущий оператор кладется в frames,
+// поэтому a = a = ... = a, ((((a)))) и - - - a любой длины не растят стек.
+// рекурсивны только [] и аргументы вызова, у них свои скобки
+Parcer::Parced<ExprNode*> Parcer::expression(Power min_power) {
+    const std::size_t base = frames.size();
+    auto fail = [this, base] {
+        frames.resize(base);
+        return failed;
+    };
+    auto push = [this, &min_power](Frame frame, Power inner) {
+        frame.outer = min_power;
+        frames.push_back(frame);
+        min_power = inner;
+    };
+
+    ExprNode* expr;
+    while (true) {
+        // операнд: префиксные операторы и открывающие скобки, затем литерал или имя
+        while (true) {
+            auto type = peek().type;
+            if (type == TokenType::LPAREN) {
+                advance();
+                push({Frame::GROUP, NONE}, NONE);
+            } else if (type == TokenType::PLUS || type == TokenType::MINUS || type == TokenType::NOT ||
+                       type == TokenType::BIT_NOT || type == TokenType::INCREMENT || type == TokenType::DECREMENT) {
+                advance();
+                push({Frame::PREFIX, NONE, opKind(type)}, PREFIX);
+            } else {
+                break;
+            }
+        }
+        auto operand = literal_expression();
+        if (!operand) return fail();
+        expr = *operand;
+
+        // операторы после операнда; оператор слабее min_power завершает верхний кадр
+        bool next_operand = false;
+        while (!next_operand) {
+            auto type = peek().type;
+            auto power = binding_power[static_cast<std::size_t>(type)];
+            if (power > min_power) {
+                advance();
+                switch (power) {
+                    case ASSIGNMENT:
+                        push({Frame::ASSIGN, NONE, opKind(type), expr}, COMMA);
+                        next_operand = true;
+                        break;
+                    case TERNARY:
+                        push({Frame::TERNARY_TRUE, NONE, OpKind::NONE, expr}, NONE);
+                        next_operand = true;
+                        break;
+                    case POSTFIX: {
+                        auto parced = postfix_expression(type, expr);
+                        if (!parced) return fail();
+                        expr = *parced;
+                        break;
+                    }
+                    default:
+                        push({Frame::BINARY, NONE, opKind(type), expr}, static_cast<Power>(power));
+                        next_operand = true;
+                        break;
+                }
+                continue;
+            }
 
-std::shared_ptr<ExprNode> Parcer::unary_expression() {  // проверить префиквсы тоже
-    if (check_advance(TokenType::PLUS) || check_advance(TokenType::MINUS) || check_advance(TokenType::NOT)) {
-        auto oper = token_array[index - 1].value;
-        auto operand = assign_expression();
-        return std::make_shared<UnaryExprNode>(oper, operand);
+            if (frames.size() == base) return expr;
+            Frame frame = frames.back();
+            frames.pop_back();
+            min_power = frame.outer;
+            switch (frame.kind) {
+                case Frame::PREFIX:
+                    expr = arena.make<UnaryExprNode>(frame.oper, expr);
+                    break;
+                case Frame::BINARY:
+                    expr = arena.make<BinaryExprNode>(frame.oper, frame.left, expr);
+                    break;
+                case Frame::ASSIGN:
+                    expr = arena.make<AssignExprNode>(frame.oper, frame.left, expr);
+                    break;
+                case Frame::GROUP:
+                    if (!check_advance(TokenType::RPAREN)) {
+                        report("ожидалось закрытие скобки", TokenType::RPAREN);
+                        return fail();
+                    }
+                    break;
+                case Frame::TERNARY_TRUE:
+                    if (!check_advance(TokenType::COLON)) {
+                        report("Ожидалось двоеточие", TokenType::COLON);
+                        return fail();
+                    }
+                    push({Frame::TERNARY_FALSE, NONE, OpKind::NONE, frame.left, expr}, COMMA);
+                    next_operand = true;
+                    break;
+                case Frame::TERNARY_FALSE:
+                    expr = arena.make<TernaryExprNode>(frame.left, frame.middle, expr);
+                    break;
+            }
+        }
     }
-    return postfix_expression();
 }
 
-std::shared_ptr<ExprNode> Parcer::postfix_expression() {
-    auto expr = literal_expression();
-    while (true) {
-        if (check_advance(TokenType::INCREMENT) || check_advance(TokenType::DECREMENT)) {
-            auto oper = token_array[index - 1].value;
-            expr = std::make_shared<PostfixExprNode>(oper, expr);
-        } else if (check_advance(TokenType::LBRACKET)) {
+Parcer::Parced<ExprNode*> Parcer::postfix_expression(TokenType type, ExprNode* expr) {
+    switch (type) {
+        case TokenType::LBRACKET: {
             auto ind = expression();
+            if (!ind) return failed;
             if (!check_advance(TokenType::RBRACKET))
-                throw std::runtime_error("Ожидалось закрытие квадратной скобки после индекса");
-            expr = std::make_shared<ArrayAccessExprNode>(expr, ind);
-        } else if (check_advance(TokenType::LPAREN)) { // отдельные функции лучше
-            std::vector<std::shared_ptr<ExprNode>> arguments;
+                return report("Ожидалось закрытие квадратной скобки после индекса", TokenType::RBRACKET);
+            return arena.make<ArrayAccessExprNode>(expr, *ind);
+        }
+        case TokenType::LPAREN: {
+            std::pmr::vector<ExprNode*> arguments(&arena);
             if (!check(TokenType::RPAREN)) {
                 do {
-                    arguments.push_back(expression());
+                    auto argument = expression(COMMA);
+                    if (!argument) return failed;
+                    arguments.push_back(*argument);
                 } while (check_advance(TokenType::COMMA));
             }
             if (!check_advance(TokenType::RPAREN))
-                throw std::runtime_error("ожидалось закрытие скобки после аргументов ф-ции");
-            expr = std::make_shared<CallExprNode>(expr, arguments);
-        } else if (check_advance(TokenType::DOT)) {
-            advance();
-            auto member = peek().value;
-            expr = std::make_shared<MemberAccessExprNode>(expr, member);
-        } else 
-            break;
+                return report("ожидалось закрытие скобки после аргументов ф-ции", TokenType::RPAREN);
+            return arena.make<CallExprNode>(expr, std::move(arguments));
+        }
+        case TokenType::DOT: {
+            if (!check(TokenType::ID))
+                return report("Ожидалось имя поля после точки", TokenType::ID);
+            auto member = symbol();
+            return arena.make<MemberAccessExprNode>(expr, member);
+        }
+        default:
+            return arena.make<PostfixExprNode>(opKind(type), expr);
     }
-
-    return expr;
 }
 
-std::shared_ptr<ExprNode> Parcer::literal_expression() {
+Parcer::Parced<ExprNode*> Parcer::literal_expression() {
+    // значения литералов уже разобраны лексером
     if (check_advance(TokenType::INT_LIT)) {
-        return std::make_shared<LiteralExprNode>(std::stoi(token_array[index - 1].value));
+        return arena.make<LiteralExprNode>(std::get<int>(previous().literal));
     } else if (check_advance(TokenType::FLOAT_LIT)) {
-        return std::make_shared<LiteralExprNode>(std::stod(token_array[index - 1].value));
+        return arena.make<LiteralExprNode>(std::get<double>(previous().literal));
     } else if (check_advance(TokenType::CHAR_LIT)) {
-        return std::make_shared<LiteralExprNode>(token_array[index - 1].value[0]);
+        return arena.make<LiteralExprNode>(std::get<char>(previous().literal));
     } else if (check_advance(TokenType::STR_LIT)) {
-        return std::make_shared<LiteralExprNode>(token_array[index - 1].value);
+        return arena.make<LiteralExprNode>(previous().value);
     } else if (check_advance(TokenType::BOOL_LIT)) {
-        if (token_array[index - 1].value == "true") {
-            return std::make_shared<LiteralExprNode>(true);    
-        } else if (token_array[index - 1].value == "false") {
-            return std::make_shared<LiteralExprNode>(false);
-        }
+        return arena.make<LiteralExprNode>(std::get<bool>(previous().literal));
     } else if (check_advance(TokenType::ID)) {
-        return std::make_shared<LiteralExprNode>(token_array[index - 1].value);
-    } else if (check_advance(TokenType::LPAREN)) {
-        auto expr = expression();
-        if (!check_advance(TokenType::RPAREN)) 
-            throw std::runtime_error("ожидалось закрытие скобки");
-        return expr;
+        return arena.make<IdExprNode>(intern(previous().value));
     }
 
-    throw std::runtime_error("Неизвестный токен: " + peek().value);
+    return report("Неизвестный токен: " + std::string(peek().value));
 }
 
-std::shared_ptr<ExprNode> Parcer::array_initialization_expression() {
+Parcer::Parced<ExprNode*> Parcer::array_initialization_expression() {
     if (!check_advance(TokenType::LBRACE))
-        throw std::runtime_error("Ожидалось открытие квадратной скобки для инициализации массива");
-    std::vector<std::shared_ptr<ExprNode>> elements;
-    while (!check(TokenType::RBRACE)) {
-        elements.push_back(expression());
+        return report("Ожидалось открытие квадратной скобки для инициализации массива", TokenType::LBRACE);
+    std::pmr::vector<ExprNode*> elements(&arena);
+    if (!check(TokenType::RBRACE)) {
+        do {
+            auto element = expression(COMMA);
+            if (!element) return failed;
+            elements.push_back(*element);
+        } while (check_advance(TokenType::COMMA));
     }
     if (!check_advance(TokenType::RBRACE))
-        throw std::runtime_error("Ожидалось закрытие квадратной скобки после конца инициализации массива");
-    return std::make_shared<ArrayInitExprNode>(elements);
-}
\ No newline at end of file
+        return report("Ожидалось закрытие квадратной скобки после конца инициализации массива", TokenType::RBRACE);
+    return arena.make<ArrayInitExprNode>(std::move(elements));
+}
@@ -0,0 +1,405 @@
+#include "resolver.hpp"
+#include "parcer.hpp"
+#include "visitor.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::string quoted(Symbol name) {
+    return "'" + std::string(symbols::name(name)) + "'";
+}
+
+}
+
+Program Resolver::resolve(ASTRootNode& root) {
+    program = {};
+    functions.clear();
+    locals.clear();
+    scopes.clear();
+    next_slot = frame_size = 0;
+    loops = 0;
+
+    Symbol builtin[] = {
+        symbols::intern("int"), symbols::intern("float"), symbols::intern("char"),
+        symbols::intern("bool"), symbols::intern("void"),
+    };
+    program.types.assign(symbols::size(), types::UNKNOWN);
+    for (TypeId type = types::INT; type <= types::VOID; ++type) program.types[builtin[type]] = type;
+    innermost.assign(symbols::size(), UNRESOLVED);
+
+    // функции видны везде, в том числе до объявления: сначала собираются все заголовки,
+    // определение с телом заменяет прототип
+    for (auto* statement : root.statements) {
+        if (!statement || statement->kind != NodeKind::FUNC_DECL) continue;
+        auto* func = static_cast<FuncDeclNode*>(statement);
+        bool defined = func->body || func->pending();
+        auto [it, added] = functions.try_emplace(func->func_name, program.functions.size());
+        if (added) {
+            program.functions.push_back(func);
+            continue;
+        }
+        auto*& known = program.functions[it->second];
+        if (defined && (known->body || known->pending()))
+            throw std::runtime_error("повторное определение функции " + quoted(func->func_name));
+        if (known->parameters.size() != func->parameters.size())
+            throw std::runtime_error("разные параметры у объявлений функции " + quoted(func->func_name));
+        if (defined) known = func;
+    }
+
+    lazy.assign(program.functions.size(), Lazy{});
+    reached.clear();
+    scopes.push_back({0, 0});
+    (*this)(root);
+    if (auto it = functions.find(symbols::intern("main")); it != functions.end()) {
+        program.main = it->second;
+        reach(program.main);
+    }
+    while (!reached.empty()) {
+        auto function = reached.back();
+        reached.pop_back();
+        define(function);
+    }
+    return std::move(program);
+}
+
+void Resolver::set_lazy_bodies(const TokenStream& stream, AstArena& arena) {
+    this->stream = &stream;
+    this->arena = &arena;
+}
+
+void Resolver::reach(std::uint32_t function) {
+    if (!program.functions[function]->pending() || lazy[function].reached) return;
+    lazy[function].reached = true;
+    reached.push_back(function);
+}
+
+// после верхнего уровня в locals только глобальные имена, по порядку объявления
+void Resolver::define(std::uint32_t function) {
+    auto& func = *program.functions[function];
+    Parcer::parce_body(*stream, *arena, func);
+    innermost.resize(symbols::size(), UNRESOLVED);     // тело могло добавить новых имен
+    program.types.resize(symbols::size(), types::UNKNOWN);
+    const auto& visible = lazy[function];
+    std::size_t globals = locals.size(), structs = program.structs.size();
+    for (std::size_t i = visible.globals; i < globals; ++i) innermost[locals[i].name] = UNRESOLVED;
+    for (std::size_t i = visible.structs; i < structs; ++i) program.types[program.structs[i].decl->name] = types::UNKNOWN;
+    (*this)(func);
+    for (std::size_t i = visible.globals; i < globals; ++i) innermost[locals[i].name] = static_cast<std::uint32_t>(i);
+    for (std::size_t i = visible.structs; i < structs; ++i)
+        program.types[program.structs[i].decl->name] = types::STRUCT + static_cast<TypeId>(i);
+}
+
+// операторы узлов выражений берут типы операндов из operands[i]
+TypeId Resolver::expression(ExprNode* node) {
+    type = types::UNKNOWN;
+    array = false;
+    if (!node) return type;
+    operands.run(*node, [this](auto& concrete) {
+        (*this)(concrete);
+        return Typed{type, array};
+    });
+    return type;
+}
+
+void Resolver::statement(ASTNode* node) {
+    if (!node) return;
+    if (node->kind <= NodeKind::ARRAY_INIT) expression(static_cast<ExprNode*>(node));
+    else visit(*node, *this);
+}
+
+void Resolver::open_scope() {
+    scopes.push_back({locals.size(), next_slot});
+}
+
+// ячейки закрытой области освобождаются для следующих объявлений той же функции
+void Resolver::close_scope() {
+    auto scope = scopes.back();
+    scopes.pop_back();
+    while (locals.size() > scope.first) {
+        innermost[locals.back().name] = locals.back().shadowed;
+        locals.pop_back();
+    }
+    next_slot = scope.next_slot;
+}
+
+const Resolver::Local& Resolver::declare(Symbol name, TypeId type, bool array, bool constant) {
+    auto depth = scopes.size() - 1;
+    if (depth > std::numeric_limits<std::uint16_t>::max())
+        throw std::runtime_error("слишком глубокая вложенность блоков");
+    auto previous = innermost[name];
+    if (previous != UNRESOLVED && previous >= scopes.back().first)
+        throw std::runtime_error("повторное объявление " + quoted(name));
+
+    std::uint32_t slot;
+    if (depth == 0) {
+        slot = program.globals++;
+    } else {
+        slot = next_slot++;
+        frame_size = std::max(frame_size, next_slot);
+    }
+    innermost[name] = static_cast<std::uint32_t>(locals.size());
+    return locals.emplace_back(Local{name, static_cast<std::uint16_t>(depth), slot, type, array, constant, previous});
+}
+
+// присваивать, увеличивать и читать можно только в переменную, элемент массива или поле,
+// и не в константу: у элемента и поля смотрится переменная, из которой они взяты
+void Resolver::check_target(ExprNode* node) const {
+    if (node->kind != NodeKind::ID && node->kind != NodeKind::ARRAY_ACCESS &&
+        node->kind != NodeKind::MEMBER_ACCESS)
+        throw std::runtime_error("ожидалась переменная, элемент массива или поле");
+    while (node->kind != NodeKind::ID) {
+        if (node->kind == NodeKind::ARRAY_ACCESS) node = static_cast<ArrayAccessExprNode*>(node)->array;
+        else if (node->kind == NodeKind::MEMBER_ACCESS) node = static_cast<MemberAccessExprNode*>(node)->object;
+        else return;
+    }
+    auto name = static_cast<IdExprNode*>(node)->name;
+    auto local = name < innermost.size() ? innermost[name] : UNRESOLVED;
+    if (local != UNRESOLVED && locals[local].constant)
+        throw std::runtime_error("нельзя изменить константу " + quoted(name));
+}
+
+// int a[] без размера и без списка не отличить от int a - это просто переменная
+bool Resolver::is_array(const VariableNode& var) {
+    return var.size || (var.init && var.init->kind == NodeKind::ARRAY_INIT);
+}
+
+TypeId Resolver::type_of(Symbol name) const {
+    auto type = program.type(name);
+    if (type == types::UNKNOWN) throw std::runtime_error("неизвестный тип " + quoted(name));
+    return type;
+}
+
+void Resolver::operator()(TernaryExprNode&) {
+    type = operands[1].type;
+    array = operands[1].array;
+}
+
+void Resolver::operator()(BinaryExprNode&) {
+    type = types::UNKNOWN;
+    array = false;
+}
+
+void Resolver::operator()(UnaryExprNode& node) {
+    if (node.oper == OpKind::INC || node.oper == OpKind::DEC) check_target(node.operand);
+    type = types::UNKNOWN;
+    array = false;
+}
+
+void Resolver::operator()(AssignExprNode& node) {
+    check_target(node.left);
+    type = operands[0].type;
+    array = operands[0].array;
+}
+
+void Resolver::operator()(PostfixExprNode& node) {
+    check_target(node.operand);
+    type = types::UNKNOWN;
+    array = false;
+}
+
+void Resolver::operator()(LiteralExprNode&) {
+    type = types::UNKNOWN;
+    array = false;
+}
+
+void Resolver::operator()(IdExprNode& node) {
+    auto local = node.name < innermost.size() ? innermost[node.name] : UNRESOLVED;
+    if (local == UNRESOLVED) {
+        if (functions.contains(node.name))
+            throw std::runtime_error("функцию " + quoted(node.name) + " можно только вызвать");
+        throw std::runtime_error("неизвестное имя " + quoted(node.name));
+    }
+    node.depth = locals[local].depth;
+    node.slot = locals[local].slot;
+    type = locals[local].type;
+    array = locals[local].array;
+}
+
+void Resolver::operator()(MemberAccessExprNode& node) {
+    auto object = operands[0].type;
+    if (object == types::UNKNOWN || object < types::STRUCT || operands[0].array)
+        throw std::runtime_error("поле " + quoted(node.member) + " можно взять только у структуры");
+    const auto& layout = program.structs[object - types::STRUCT];
+    for (std::uint32_t i = 0; i < layout.fields.size(); ++i) {
+        if (layout.fields[i]->name == node.member) {
+            node.field = i;
+            type = layout.field_types[i];
+            array = is_array(*layout.fields[i]);
+            return;
+        }
+    }
+    throw std::runtime_error("в структуре " + quoted(layout.decl->name) + " нет поля " + quoted(node.member));
+}
+
+void Resolver::operator()(CallExprNode& node) {
+    if (node.called->kind != NodeKind::ID)
+        throw std::runtime_error("вызвать можно только функцию по имени");
+    auto name = static_cast<IdExprNode*>(node.called)->name;
+    auto it = functions.find(name);
+    if (it == functions.end()) throw std::runtime_error("неизвестная функция " + quoted(name));
+    const auto& func = *program.functions[it->second];
+    if (node.arguments.size() != func.parameters.size())
+        throw std::runtime_error("неверное число аргументов у " + quoted(name));
+    node.function = it->second;
+    reach(it->second);
+    type = type_of(func.func_type);
+    array = false;
+}
+
+void Resolver::operator()(ArrayAccessExprNode&) {
+    if (!operands[0].array) throw std::runtime_error("индексировать можно только массив");
+    type = operands[0].type;
+    array = false;
+}
+
+void Resolver::operator()(ArrayInitExprNode&) {
+    type = types::UNKNOWN;
+    array = true;
+}
+
+void Resolver::operator()(ReturnStatmNode& node) {
+    statement(node.expr);
+}
+
+void Resolver::operator()(BreakStatmNode&) {
+    if (loops == 0) throw std::runtime_error("break вне цикла");
+}
+
+void Resolver::operator()(ContinueStatmNode&) {
+    if (loops == 0) throw std::runtime_error("continue вне цикла");
+}
+
+void Resolver::operator()(ConditionStatmNode& node) {
+    expression(node.condition);
+    statement(node.then_statm);
+    statement(node.else_statm);
+}
+
+void Resolver::operator()(ExprStatmNode& node) {
+    statement(node.expr);   // выражение или объявление переменных
+}
+
+void Resolver::operator()(BlockStatmNode& node) {
+    open_scope();
+    for (auto* statement : node.statements) this->statement(statement);
+    close_scope();
+}
+
+void Resolver::operator()(ForStatmNode& node) {
+    open_scope();   // переменная из init видна только в цикле
+    statement(node.init);
+    expression(node.condition);
+    expression(node.incr);
+    ++loops;
+    statement(node.body);
+    --loops;
+    close_scope();
+}
+
+void Resolver::operator()(WhileStatmNode& node) {
+    expression(node.condition);
+    ++loops;
+    statement(node.body);
+    --loops;
+}
+
+void Resolver::operator()(InputStatmNode& node) {
+    if (!node.expr) return;
+    auto* target = static_cast<ExprStatmNode*>(node.expr)->expr;
+    check_target(static_cast<ExprNode*>(target));
+    statement(node.expr);
+}
+
+void Resolver::operator()(OutStatmNode& node) {
+    statement(node.expr);
+}
+
+void Resolver::operator()(SZFStatmNode& node) {
+    expression(node.expr);
+}
+
+void Resolver::operator()(ExitStatmNode& node) {
+    expression(node.expr);
+}
+
+// размер и начальное значение считаются до объявления: в int x = x справа внешний x
+void Resolver::operator()(VarDeclNode& node) {
+    auto var_type = type_of(node.type);
+    if (var_type == types::VOID) throw std::runtime_error("переменная не может быть void");
+    for (auto& var : node.variables) {
+        if (node.constant && !var.init)
+            throw std::runtime_error("константа " + quoted(var.name) + " без начального значения");
+        expression(var.size);
+        expression(var.init);
+        const auto& local = declare(var.name, var_type, is_array(var), node.constant);
+        var.depth = local.depth;
+        var.slot = local.slot;
+    }
+}
+
+// параметры - первые ячейки кадра, верхний уровень тела - в той же области, что и они
+void Resolver::operator()(FuncDeclNode& node) {
+    type_of(node.func_type);
+    if (node.pending()) {
+        if (!stream) throw std::runtime_error("тело функции " + quoted(node.func_name) + " не разобрано");
+        auto& visible = lazy[functions[node.func_name]];
+        visible.globals = locals.size();
+        visible.structs = program.structs.size();
+        return;
+    }
+    if (!node.body) return;
+
+    next_slot = frame_size = 0;
+    open_scope();
+    for (const auto& [param_type, param_name] : node.parameters) {
+        auto type = type_of(param_type);
+        if (type == types::VOID) throw std::runtime_error("параметр не может быть void");
+        declare(param_name, type, false);
+    }
+    for (auto* statement : node.body->statements) this->statement(statement);
+    close_scope();
+    node.frame_size = frame_size;
+}
+
+void Resolver::operator()(StructDeclNode& node) {
+    add_struct(node);
+}
+
+void Resolver::operator()(AssertDeclNode& node) {
+    expression(node.expr);
+}
+
+void Resolver::operator()(ASTRootNode& node) {
+    for (auto* statement : node.statements) this->statement(statement);
+}
+
+// поля нумеруются подряд по всем объявлениям. поле-структура должна быть объявлена раньше,
+// так что структура не может содержать сама себя. размеры и значения полей по умолчанию
+// разрешаются в глобальной области - они вычисляются при каждом создании структуры
+void Resolver::add_struct(StructDeclNode& node) {
+    if (program.type(node.name) != types::UNKNOWN)
+        throw std::runtime_error("повторное объявление типа " + quoted(node.name));
+    StructLayout layout{&node, {}, {}};
+    for (auto* decl : node.fields) {
+        if (!decl) continue;
+        auto field_type = type_of(decl->type);
+        if (field_type == types::VOID) throw std::runtime_error("поле не может быть void");
+        if (decl->constant) throw std::runtime_error("поле не может быть const");
+        for (auto& var : decl->variables) {
+            expression(var.size);
+            expression(var.init);
+            for (auto* field : layout.fields) {
+                if (field->name == var.name)
+                    throw std::runtime_error("повторное поле " + quoted(var.name));
+            }
+            layout.fields.push_back(&var);
+            layout.field_types.push_back(field_type);
+        }
+    }
+    program.types[node.name] = types::STRUCT + static_cast<TypeId>(program.structs.size());
+    program.structs.push_back(std::move(layout));
+}
@@ -0,0 +1,131 @@
+#include "scan.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// x - lo <= hi - lo в беззнаковой арифметике: одна проверка диапазона на байт
+#ifdef __SSE2__
+__m128i in_range(__m128i x, char lo, char hi) {
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+}
+#endif
+
+#ifdef __AVX2__
+__m256i in_range(__m256i x, char lo, char hi) {
+    __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(hi - lo)), t);
+}
+#endif
+
+struct Space {
+    static bool scalar(char c) { return scan::is(c, scan::SPACE); }
+#ifdef __SSE2__
+    static __m128i vector(__m128i x) {
+        return _mm_or_si128(in_range(x, '\t', '\r'), _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+    }
+#endif
+#ifdef __AVX2__
+    static __m256i vector(__m256i x) {
+        return _mm256_or_si256(in_range(x, '\t', '\r'), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')));
+    }
+#endif
+};
+
+struct Ident {
+    static bool scalar(char c) { return scan::is(c, scan::IDENT); }
+#ifdef __SSE2__
+    static __m128i vector(__m128i x) {
+        __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20)); // 'A'..'Z' -> 'a'..'z'
+        return _mm_or_si128(
+            _mm_or_si128(in_range(lower, 'a', 'z'), in_range(x, '0', '9')),
+            _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+    }
+#endif
+#ifdef __AVX2__
+    static __m256i vector(__m256i x) {
+        __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+        return _mm256_or_si256(
+            _mm256_or_si256(in_range(lower, 'a', 'z'), in_range(x, '0', '9')),
+            _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+    }
+#endif
+};
+
+struct Digit {
+    static bool scalar(char c) { return scan::is(c, scan::DIGIT); }
+#ifdef __SSE2__
+    static __m128i vector(__m128i x) { return in_range(x, '0', '9'); }
+#endif
+#ifdef __AVX2__
+    static __m256i vector(__m256i x) { return in_range(x, '0', '9'); }
+#endif
+};
+
+struct NotQuote {
+    static bool scalar(char c) { return c != '"'; }
+#ifdef __SSE2__
+    static __m128i vector(__m128i x) {
+        return _mm_xor_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_set1_epi8(-1));
+    }
+#endif
+#ifdef __AVX2__
+    static __m256i vector(__m256i x) {
+        return _mm256_xor_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_set1_epi8(-1));
+    }
+#endif
+};
+
+template <typename Class>
+std::size_t span(std::string_view input, std::size_t index) noexcept {
+    const char* data = input.data();
+    std::size_t size = input.size();
+
+    // короткие серии (один пробел, имя из пары букв) встречаются чаще всего,
+    // поэтому первые символы проверяем по таблице без загрузки вектора
+    for (int i = 0; i < 4; ++i, ++index) {
+        if (index >= size || !Class::scalar(data[index])) return index;
+    }
+
+#ifdef __AVX2__
+    for (; index + 32 <= size; index += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(Class::vector(x)));
+        if (mask) return index + __builtin_ctz(mask);
+    }
+#endif
+#ifdef __SSE2__
+    for (; index + 16 <= size; index += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(Class::vector(x))) & 0xFFFF;
+        if (mask) return index + __builtin_ctz(mask);
+    }
+#endif
+    while (index < size && Class::scalar(data[index])) ++index;
+    return index;
+}
+
+}
+
+namespace scan {
+
+std::size_t skip_space(std::string_view input, std::size_t index) noexcept {
+    return span<Space>(input, index);
+}
+
+std::size_t skip_ident(std::string_view input, std::size_t index) noexcept {
+    return span<Ident>(input, index);
+}
+
+std::size_t skip_digits(std::string_view input, std::size_t index) noexcept {
+    return span<Digit>(input, index);
+}
+
+std::size_t find_quote(std::string_view input, std::size_t index) noexcept {
+    return span<NotQuote>(input, index);
+}
+
+}
@@ -0,0 +1,93 @@
+#include "source.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceBuffer::~SourceBuffer() {
+    if (mapped) munmap(const_cast<char*>(data.data()), data.size());
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::map_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Не получилось получить доступ к файлу: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        throw std::runtime_error("Не получилось получить размер файла: " + path);
+    }
+    if (!S_ISREG(info.st_mode)) {
+        // у канала и FIFO размера нет, а отобразить их нельзя - текст читается до конца
+        std::string text;
+        char chunk[1 << 16];
+        for (;;) {
+            ssize_t got = read(fd, chunk, sizeof chunk);
+            if (got == 0) break;
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                close(fd);
+                throw std::runtime_error("Не получилось прочитать файл: " + path);
+            }
+            text.append(chunk, static_cast<std::size_t>(got));
+        }
+        close(fd);
+        auto buffer = std::make_unique<SourceBuffer>(std::move(text));
+        buffer->file = path;
+        return buffer;
+    }
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    if (size == 0) {
+        close(fd);
+        return std::unique_ptr<SourceBuffer>(new SourceBuffer(path, "", 0)); // пустой файл отобразить нельзя
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; // страницы подгружаются сразу, в потоке загрузчика
+#endif
+    void* mapping = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Не получилось отобразить файл в память: " + path);
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    return std::unique_ptr<SourceBuffer>(new SourceBuffer(path, static_cast<const char*>(mapping), size));
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::edited(const SourceEdit& edit) const {
+    if (edit.offset > data.size() || edit.removed > data.size() - edit.offset)
+        throw std::runtime_error("Правка выходит за границы файла");
+    std::string updated;
+    updated.reserve(data.size() - edit.removed + edit.inserted.size());
+    updated.append(data.substr(0, edit.offset));
+    updated.append(edit.inserted);
+    updated.append(data.substr(edit.offset + edit.removed));
+    auto buffer = std::make_unique<SourceBuffer>(std::move(updated));
+    buffer->file = file;
+    return buffer;
+}
+
+SourceLocation SourceBuffer::location(std::size_t offset) const {
+    std::call_once(lines_once, [this] {
+        line_starts.push_back(0);
+        for (std::size_t i = data.find('\n'); i != std::string_view::npos; i = data.find('\n', i + 1)) {
+            line_starts.push_back(static_cast<std::uint32_t>(i + 1));
+        }
+    });
+    auto line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - 1;
+    return {static_cast<std::uint32_t>(line - line_starts.begin() + 1),
+            static_cast<std::uint32_t>(offset - *line + 1)};
+}
+
+std::string SourceBuffer::where(std::size_t offset) const {
+    SourceLocation loc = location(offset);
+    std::string prefix = file.empty() ? "" : file + ":";
+    return prefix + std::to_string(loc.line) + ":" + std::to_string(loc.column);
+}
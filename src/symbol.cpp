@@ -0,0 +1,55 @@
+#include "symbol.hpp"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Table {
+    std::shared_mutex mutex;
+    std::deque<std::string> storage;                   // deque не двигает строки при росте
+    std::vector<std::string_view> names;               // номер -> текст
+    std::unordered_map<std::string_view, Symbol> ids;  // текст -> номер
+};
+
+Table& table() {
+    static Table instance;
+    return instance;
+}
+
+}
+
+namespace symbols {
+
+Symbol intern(std::string_view text) {
+    Table& t = table();
+    {
+        std::shared_lock lock(t.mutex);
+        if (auto it = t.ids.find(text); it != t.ids.end()) return it->second;
+    }
+    std::unique_lock lock(t.mutex);
+    if (auto it = t.ids.find(text); it != t.ids.end()) return it->second; // успели добавить без нас
+    std::string_view stored = t.storage.emplace_back(text);
+    auto symbol = static_cast<Symbol>(t.names.size());
+    t.names.push_back(stored);
+    t.ids.emplace(stored, symbol);
+    return symbol;
+}
+
+std::string_view name(Symbol symbol) {
+    Table& t = table();
+    std::shared_lock lock(t.mutex);
+    return t.names[symbol];
+}
+
+std::size_t size() {
+    Table& t = table();
+    std::shared_lock lock(t.mutex);
+    return t.names.size();
+}
+
+}
@@ -0,0 +1,68 @@
+#include "token_stream.hpp"
+#include "lexer.hpp"
+
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+static_assert(static_cast<int>(TokenType::ESCLIT) <= std::numeric_limits<std::uint8_t>::max());
+
+TokenStream::TokenStream(const SourceBuffer& source) : source(source) {
+    check_size();
+    Lexer lexer(source);
+    while (true) {
+        Token token = lexer.next();
+        push(token);
+        if (token.type == TokenType::END_OF_FILE) break;
+    }
+}
+
+TokenStream::TokenStream(const SourceBuffer& source, const std::vector<Token>& tokens) : source(source) {
+    check_size();
+    kinds.reserve(tokens.size());
+    offsets.reserve(tokens.size());
+    for (const Token& token : tokens) push(token);
+}
+
+Token TokenStream::operator[](std::size_t index) const {
+    TokenType kind = type(index);
+    std::uint64_t mask = payload_mask[index / 64];
+    std::uint64_t bit = std::uint64_t(1) << (index % 64);
+    if (!(mask & bit)) {
+        return {kind, source.view().substr(offsets[index], tokenSpelling(kind).size())};
+    }
+    const Payload& payload = payloads[payload_rank[index / 64] + std::popcount(mask & (bit - 1))];
+    Token token{kind, source.view().substr(offsets[index], payload.length)};
+    if (payload.literal != NO_LITERAL) token.literal = literals[payload.literal];
+    return token;
+}
+
+std::size_t TokenStream::memory() const noexcept {
+    return kinds.capacity() * sizeof(std::uint8_t) + offsets.capacity() * sizeof(std::uint32_t) +
+           payload_mask.capacity() * sizeof(std::uint64_t) + payload_rank.capacity() * sizeof(std::uint32_t) +
+           payloads.capacity() * sizeof(Payload) + literals.capacity() * sizeof(LiteralValue);
+}
+
+void TokenStream::push(const Token& token) {
+    std::size_t index = kinds.size();
+    if (index % 64 == 0) {
+        payload_mask.push_back(0);
+        payload_rank.push_back(static_cast<std::uint32_t>(payloads.size()));
+    }
+    kinds.push_back(static_cast<std::uint8_t>(token.type));
+    offsets.push_back(static_cast<std::uint32_t>(source.offset_of(token.value)));
+    if (tokenSpelling(token.type).empty()) {
+        payload_mask.back() |= std::uint64_t(1) << (index % 64);
+        std::uint32_t literal = NO_LITERAL;
+        if (!std::holds_alternative<std::monostate>(token.literal)) {
+            literal = static_cast<std::uint32_t>(literals.size());
+            literals.push_back(token.literal);
+        }
+        payloads.push_back({static_cast<std::uint32_t>(token.value.size()), literal});
+    }
+}
+
+void TokenStream::check_size() const {
+    if (source.size() > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("Файл больше 4 ГБ, смещения токенов не помещаются в 32 бита");
+}
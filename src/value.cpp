@@ -0,0 +1,234 @@
+#include "value.hpp"
+
+#include <climits>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace {
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error(message);
+}
+
+// строки в дереве - как в исходнике, escape-последовательности раскрываются при печати
+void print_string(std::ostream& out, std::string_view text) {
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            out << text[i];
+            continue;
+        }
+        switch (text[++i]) {
+            case 'n': out << '\n'; break;
+            case 't': out << '\t'; break;
+            case '0': out << '\0'; break;
+            default: out << text[i]; break;
+        }
+    }
+}
+
+}
+
+// размер массива задает программа, так что нехватка памяти - ее ошибка, а не аварийный выход
+Object* Heap::allocate(std::size_t size) {
+    try {
+        objects.push_back(std::make_unique<Object>(Object{std::vector<Value>(size)}));
+    } catch (const std::bad_alloc&) {
+        fail("не хватает памяти для массива из " + std::to_string(size) + " элементов");
+    } catch (const std::length_error&) {
+        fail("не хватает памяти для массива из " + std::to_string(size) + " элементов");
+    }
+    return objects.back().get();
+}
+
+Object* Heap::clone(const Object& object) {
+    auto* copy = allocate(object.slots.size());
+    for (std::size_t i = 0; i < object.slots.size(); ++i) {
+        const auto& slot = object.slots[i];
+        if (slot.is_object()) copy->slots[i] = clone(*slot.as_object());
+        else copy->slots[i] = slot;
+    }
+    return copy;
+}
+
+void Heap::release(std::size_t mark) {
+    if (objects.size() > mark) objects.erase(objects.begin() + mark, objects.end());
+}
+
+void Heap::release(std::size_t first, std::size_t last) {
+    if (last > first) objects.erase(objects.begin() + first, objects.begin() + last);
+}
+
+namespace values {
+
+Value literal(const std::variant<int, double, bool, char, std::string_view>& literal) {
+    return std::visit([](const auto& value) -> Value {
+        if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string_view>) return &value;
+        else return value;
+    }, literal);
+}
+
+int to_int(const Value& value) {
+    switch (value.index()) {
+        case INT: return value.as_int();
+        case DOUBLE: return static_cast<int>(value.as_double());
+        case BOOL: return value.as_bool();
+        case CHAR: return value.as_char();
+        default: fail("ожидалось число");
+    }
+}
+
+double to_double(const Value& value) {
+    if (value.is_double()) return value.as_double();
+    return to_int(value);
+}
+
+bool truth(const Value& value) {
+    switch (value.index()) {
+        case INT: return value.as_int() != 0;
+        case DOUBLE: return value.as_double() != 0;
+        case BOOL: return value.as_bool();
+        case CHAR: return value.as_char() != 0;
+        default: fail("ожидалось число");
+    }
+}
+
+Object* to_object(const Value& value) {
+    if (value.is_object()) return value.as_object();
+    fail("ожидался массив или структура");
+}
+
+// целые переполняются по модулю 2^32, а не как неопределенное поведение си
+Value arithmetic(OpKind oper, const Value& left, const Value& right) {
+    if (!left.is_double() && !right.is_double()) {
+        int a = to_int(left);
+        int b = to_int(right);
+        auto u = [](int x) { return static_cast<unsigned>(x); };
+        switch (oper) {
+            case OpKind::ADD: return static_cast<int>(u(a) + u(b));
+            case OpKind::SUB: return static_cast<int>(u(a) - u(b));
+            case OpKind::MUL: return static_cast<int>(u(a) * u(b));
+            case OpKind::DIV:
+                if (b == 0) fail("деление на ноль");
+                return a == INT_MIN && b == -1 ? a : a / b;
+            case OpKind::MOD:
+                if (b == 0) fail("деление на ноль");
+                return a == INT_MIN && b == -1 ? 0 : a % b;
+            case OpKind::EQ: return a == b;
+            case OpKind::NEQ: return a != b;
+            case OpKind::LT: return a < b;
+            case OpKind::GT: return a > b;
+            case OpKind::LEQ: return a <= b;
+            case OpKind::GEQ: return a >= b;
+            case OpKind::BIT_AND: return a & b;
+            case OpKind::BIT_OR: return a | b;
+            case OpKind::BIT_XOR: return a ^ b;
+            case OpKind::SHL: return static_cast<int>(u(a) << (b & 31));
+            case OpKind::SHR: return a >> (b & 31);
+            default: break;
+        }
+    } else {
+        double a = to_double(left);
+        double b = to_double(right);
+        switch (oper) {
+            case OpKind::ADD: return a + b;
+            case OpKind::SUB: return a - b;
+            case OpKind::MUL: return a * b;
+            case OpKind::DIV: return a / b;
+            case OpKind::EQ: return a == b;
+            case OpKind::NEQ: return a != b;
+            case OpKind::LT: return a < b;
+            case OpKind::GT: return a > b;
+            case OpKind::LEQ: return a <= b;
+            case OpKind::GEQ: return a >= b;
+            default: break;
+        }
+    }
+    fail("оператор '" + std::string(opSpelling(oper)) + "' не применим к этим значениям");
+}
+
+// размеры как у типов си: int 4, float хранится как double - 8; у массива и структуры -
+// сумма элементов без выравнивания, у строки - с завершающим нулем
+int size_of(const Value& value) {
+    switch (value.index()) {
+        case INT: return sizeof(int);
+        case DOUBLE: return sizeof(double);
+        case BOOL: return 1;
+        case CHAR: return 1;
+        case STRING: return static_cast<int>(value.as_string().size()) + 1;
+        case OBJECT: {
+            int size = 0;
+            for (const auto& slot : value.as_object()->slots) size += size_of(slot);
+            return size;
+        }
+        default: return 0;
+    }
+}
+
+void print(std::ostream& out, const Value& value) {
+    switch (value.index()) {
+        case INT: out << value.as_int(); break;
+        case DOUBLE: out << value.as_double(); break;
+        case BOOL: out << (value.as_bool() ? "true" : "false"); break;
+        case CHAR: out << value.as_char(); break;
+        case STRING: print_string(out, value.as_string()); break;
+        case OBJECT: {
+            out << '{';
+            const auto& slots = value.as_object()->slots;
+            for (std::size_t i = 0; i < slots.size(); ++i) {
+                if (i) out << ", ";
+                print(out, slots[i]);
+            }
+            out << '}';
+            break;
+        }
+        default: fail("нет значения для печати");
+    }
+}
+
+Value unary(OpKind oper, const Value& operand) {
+    switch (oper) {
+        case OpKind::ADD: return arithmetic(OpKind::ADD, 0, operand);
+        case OpKind::SUB: return arithmetic(OpKind::SUB, 0, operand);
+        case OpKind::NOT: return !truth(operand);
+        case OpKind::BIT_NOT: return ~to_int(operand);
+        default: fail("неизвестный унарный оператор '" + std::string(opSpelling(oper)) + "'");
+    }
+}
+
+void assign(Value& target, const Value& source) {
+    switch (target.index()) {
+        case INT: target = to_int(source); break;
+        case DOUBLE: target = to_double(source); break;
+        case BOOL: target = truth(source); break;
+        case CHAR: target = static_cast<char>(to_int(source)); break;
+        case OBJECT: {
+            auto* to = target.as_object();
+            auto* from = to_object(source);
+            if (to == from) break;
+            if (to->slots.size() != from->slots.size()) fail("размеры массивов или структур не совпадают");
+            for (std::size_t i = 0; i < to->slots.size(); ++i) assign(to->slots[i], from->slots[i]);
+            break;
+        }
+        default: target = source; break;
+    }
+}
+
+bool read(std::istream& in, Value& target) {
+    switch (target.index()) {
+        case INT: { int x; if (!(in >> x)) return false; target = x; return true; }
+        case DOUBLE: { double x; if (!(in >> x)) return false; target = x; return true; }
+        case CHAR: { char x; if (!(in >> x)) return false; target = x; return true; }
+        case BOOL: {
+            std::string word;
+            if (!(in >> word) || (word != "true" && word != "false" && word != "1" && word != "0")) return false;
+            target = word == "true" || word == "1";
+            return true;
+        }
+        default: fail("read читает только числа, символы и bool");
+    }
+}
+
+}
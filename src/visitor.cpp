@@ -1,20 +1,45 @@
+#include <algorithm>
 #include <iostream>
-#include <memory>
 #include <variant>
 #include "visitor.hpp"
 #include "ast.hpp"
 
-void PrintVisitor::visit(TernaryExprNode& expr)  { 
+void PrintVisitor::print(ASTNode& root) {
+    work.push_back({&root, {}});
+    while (!work.empty()) {
+        Item item = work.back();
+        work.pop_back();
+        if (!item.node) {
+            std::cout << item.text;
+            continue;
+        }
+        // узел дописал свои части по порядку - переворот, чтобы первая была наверху
+        std::size_t mark = work.size();
+        visit(*item.node, *this);
+        std::reverse(work.begin() + mark, work.end());
+    }
+    std::cout.flush();
+}
+
+void PrintVisitor::then(ASTNode* node) {
+    if (node) work.push_back({node, {}});
+}
+
+void PrintVisitor::then(std::string_view text) {
+    work.push_back({nullptr, text});
+}
+
+void PrintVisitor::operator()(TernaryExprNode& expr)  { 
     std::cout << "Ternary(";
-    expr.condition.get()->accept(*this); 
-    std::cout << " ? ";
-    expr.true_expr.get()->accept(*this); 
-    std::cout << " : ";
-    expr.false_expr.get()->accept(*this); 
-    std::cout << ")";
+    then(expr.condition); 
+    then(" ? ");
+    then(expr.true_expr); 
+    then(" : ");
+    then(expr.false_expr); 
+    then(")");
 }
 
-void PrintVisitor::visit(LiteralExprNode& expr) {
+void PrintVisitor::operator()(LiteralExprNode& expr) {
     std::cout << "Literal(";
     if (std::holds_alternative<int>(expr.value)) {
         std::cout << std::get<int>(expr.value);
@@ -24,225 +49,241 @@ void PrintVisitor::visit(LiteralExprNode& expr) {
         std::cout << (std::get<bool>(expr.value) ? "true" : "false");
     } else if (std::holds_alternative<char>(expr.value)) {
         std::cout << "'" << std::get<char>(expr.value) << "'";
-    } else if (std::holds_alternative<std::string>(expr.value)) {
-        std::cout << "\"" << std::get<std::string>(expr.value) << "\"";
+    } else if (std::holds_alternative<std::string_view>(expr.value)) {
+        std::cout << "\"" << std::get<std::string_view>(expr.value) << "\"";
     } else {
         std::cout << "Unknown";
     }
     std::cout << ")";
 }
 
-void PrintVisitor::visit(IdExprNode& expr) {
-    std::cout << "ID(" << expr.name << ")";
+void PrintVisitor::operator()(IdExprNode& expr) {
+    std::cout << "ID(" << symbols::name(expr.name) << ")";
 }
 
-void PrintVisitor::visit(BinaryExprNode& expr) {
-    std::cout << "Binary(" << expr.oper << ", ";
-    expr.left->accept(*this);
-    std::cout << ", ";
-    expr.right->accept(*this);
-    std::cout << ")";
+void PrintVisitor::operator()(BinaryExprNode& expr) {
+    std::cout << "Binary(" << opSpelling(expr.oper) << ", ";
+    then(expr.left);
+    then(", ");
+    then(expr.right);
+    then(")");
 }
 
-void PrintVisitor::visit(UnaryExprNode& expr) {
-    std::cout << "Unary(" << expr.oper << ", ";
-    expr.operand->accept(*this);
-    std::cout << ")";
+void PrintVisitor::operator()(UnaryExprNode& expr) {
+    std::cout << "Unary(" << opSpelling(expr.oper) << ", ";
+    then(expr.operand);
+    then(")");
 }
 
-void PrintVisitor::visit(AssignExprNode& expr) {
+void PrintVisitor::operator()(AssignExprNode& expr) {
     std::cout << "Assign(";
-    expr.left->accept(*this);
-    std::cout << " = ";
-    expr.right->accept(*this);
-    std::cout << ")";
+    then(expr.left);
+    then(" ");
+    then(opSpelling(expr.oper));
+    then(" ");
+    then(expr.right);
+    then(")");
 }
 
-void PrintVisitor::visit(PostfixExprNode& expr) {
+void PrintVisitor::operator()(PostfixExprNode& expr) {
     std::cout << "Postfix(";
-    expr.operand->accept(*this);
-    std::cout << expr.oper << ")";
+    then(expr.operand);
+    then(opSpelling(expr.oper));
+    then(")");
 }
 
-void PrintVisitor::visit(MemberAccessExprNode& expr) {
+void PrintVisitor::operator()(MemberAccessExprNode& expr) {
     std::cout << "Access(";
-    expr.object->accept(*this);
-    std::cout << "." << expr.member << ")";
+    then(expr.object);
+    then(".");
+    then(symbols::name(expr.member));
+    then(")");
 }
 
-void PrintVisitor::visit(CallExprNode& expr) {
+void PrintVisitor::operator()(CallExprNode& expr) {
     std::cout << "Call(";
-    expr.called->accept(*this);
-    std::cout << ", [";
+    then(expr.called);
+    then(", [");
     for (size_t i = 0; i < expr.arguments.size(); ++i) {
-        expr.arguments[i]->accept(*this);
-        if (i + 1 < expr.arguments.size()) std::cout << ", ";
+        then(expr.arguments[i]);
+        if (i + 1 < expr.arguments.size()) then(", ");
     }
-    std::cout << "])";
+    then("])");
 }
 
-void PrintVisitor::visit(ArrayAccessExprNode& expr) {
+void PrintVisitor::operator()(ArrayAccessExprNode& expr) {
     std::cout << "Array(";
-    expr.array->accept(*this);
-    std::cout << "[";
-    expr.index->accept(*this);
-    std::cout << "])";
+    then(expr.array);
+    then("[");
+    then(expr.index);
+    then("])");
 }
 
-void PrintVisitor::visit(ArrayInitExprNode& expr) {
+void PrintVisitor::operator()(ArrayInitExprNode& expr) {
     std::cout << "ArrayInit([";
     for (size_t i = 0; i < expr.elements.size(); ++i) {
-        expr.elements[i]->accept(*this);
-        if (i + 1 < expr.elements.size()) std::cout << ", ";
+        then(expr.elements[i]);
+        if (i + 1 < expr.elements.size()) then(", ");
     }
-    std::cout << "])";
+    then("])");
 }
 
 // === Statements ===
 
-void PrintVisitor::visit(ExprStatmNode& stmt) {
+void PrintVisitor::operator()(ExprStatmNode& stmt) {
     std::cout << "Expr(";
-    stmt.expr->accept(*this);
-    std::cout << ")";
+    then(stmt.expr);
+    then(")");
 }
 
-void PrintVisitor::visit(BlockStatmNode& stmt) {
+void PrintVisitor::operator()(BlockStatmNode& stmt) {
     std::cout << "Block([";
     for (size_t i = 0; i < stmt.statements.size(); ++i) {
-        stmt.statements[i]->accept(*this);
-        if (i + 1 < stmt.statements.size()) std::cout << ", ";
+        then(stmt.statements[i]);
+        if (i + 1 < stmt.statements.size()) then(", ");
     }
-    std::cout << "])";
+    then("])");
 }
 
-void PrintVisitor::visit(ConditionStatmNode& stmt) {
+void PrintVisitor::operator()(ConditionStatmNode& stmt) {
     std::cout << "If(";
-    stmt.condition->accept(*this);
-    std::cout << ", ";
-    stmt.then_statm->accept(*this);
+    then(stmt.condition);
+    then(", ");
+    then(stmt.then_statm);
     if (stmt.else_statm) {
-        std::cout << ", ";
-        stmt.else_statm->accept(*this);
+        then(", ");
+        then(stmt.else_statm);
     }
-    std::cout << ")";
+    then(")");
 }
 
-void PrintVisitor::visit(WhileStatmNode& stmt) {
+void PrintVisitor::operator()(WhileStatmNode& stmt) {
+    if (stmt.do_while) {
+        std::cout << "DoWhile(";
+        then(stmt.body);
+        then(", ");
+        then(stmt.condition);
+        then(")");
+        return;
+    }
     std::cout << "While(";
-    stmt.condition->accept(*this);
-    std::cout << ", ";
-    stmt.body->accept(*this);
-    std::cout << ")";
+    then(stmt.condition);
+    then(", ");
+    then(stmt.body);
+    then(")");
 }
 
-void PrintVisitor::visit(ForStatmNode& stmt) {
+void PrintVisitor::operator()(ForStatmNode& stmt) {
     std::cout << "For(";
-    stmt.init->accept(*this);
-    std::cout << "; ";
-    stmt.condition->accept(*this);
-    std::cout << "; ";
-    stmt.incr->accept(*this);
-    std::cout << ", ";
-    stmt.body->accept(*this);
-    std::cout << ")";
+    then(stmt.init);
+    then("; ");
+    then(stmt.condition);
+    then("; ");
+    then(stmt.incr);
+    then(", ");
+    then(stmt.body);
+    then(")");
 }
 
-void PrintVisitor::visit(ReturnStatmNode& stmt) {
+void PrintVisitor::operator()(ReturnStatmNode& stmt) {
     std::cout << "Return(";
-    if (stmt.expr) stmt.expr->accept(*this);
-    std::cout << ")";
+    then(stmt.expr);
+    then(")");
 }
 
-void PrintVisitor::visit(BreakStatmNode&) {
+void PrintVisitor::operator()(BreakStatmNode&) {
     std::cout << "Break";
 }
 
-void PrintVisitor::visit(ContinueStatmNode&) {
+void PrintVisitor::operator()(ContinueStatmNode&) {
     std::cout << "Continue";
 }
 
-void PrintVisitor::visit(InStatmNode& stmt) {
+void PrintVisitor::operator()(InputStatmNode& stmt) {
     std::cout << "Read(";
-    stmt.expr->accept(*this);
-    std::cout << ")";
+    then(stmt.expr);
+    then(")");
 }
 
-void PrintVisitor::visit(OutStatmNode& stmt) {
+void PrintVisitor::operator()(OutStatmNode& stmt) {
     std::cout << "Print(";
-    stmt.expr->accept(*this);
-    std::cout << ")";
+    then(stmt.expr);
+    then(")");
 }
 
-void PrintVisitor::visit(SZFStatmNode& stmt) {
+void PrintVisitor::operator()(SZFStatmNode& stmt) {
     std::cout << "Sizeof(";
-    stmt.expr->accept(*this);
-    std::cout << ")";
+    then(stmt.expr);
+    then(")");
 }
 
-void PrintVisitor::visit(ExitStatmNode& stmt) {
+void PrintVisitor::operator()(ExitStatmNode& stmt) {
     std::cout << "Exit(";
-    if (stmt.expr) stmt.expr->accept(*this);
-    std::cout << ")";
+    then(stmt.expr);
+    then(")");
 }
 
 // === Declarations ===
 
-void PrintVisitor::visit(VarDeclNode& stmt) {
-    std::cout << "VarDecl(" << stmt.type << ", [";
+void PrintVisitor::operator()(VarDeclNode& stmt) {
+    std::cout << "VarDecl(" << (stmt.constant ? "const " : "") << symbols::name(stmt.type) << ", [";
     for (size_t i = 0; i < stmt.variables.size(); ++i) {
         const auto& var = stmt.variables[i];
-        std::cout << var.name;
+        then(symbols::name(var.name));
         if (var.size) {
-            std::cout << "[";
-            var.size->accept(*this);
-            std::cout << "]";
+            then("[");
+            then(var.size);
+            then("]");
         }
         if (var.init) {
-            std::cout << " = ";
-            var.init->accept(*this);
+            then(" = ");
+            then(var.init);
         }
-        if (i + 1 < stmt.variables.size()) std::cout << ", ";
+        if (i + 1 < stmt.variables.size()) then(", ");
     }
-    std::cout << "])";
+    then("])");
 }
 
-void PrintVisitor::visit(FuncDeclNode& decl) {
-    std::cout << "Func(" << decl.func_type << " " << decl.func_name << ", [";
+void PrintVisitor::operator()(FuncDeclNode& decl) {
+    std::cout << "Func(" << symbols::name(decl.func_type) << " " << symbols::name(decl.func_name) << ", [";
     for (size_t i = 0; i < decl.parameters.size(); ++i) {
         const auto& param = decl.parameters[i];
-        std::cout << param.first << " " << param.second;
+        std::cout << symbols::name(param.first) << " " << symbols::name(param.second);
         if (i + 1 < decl.parameters.size()) std::cout << ", ";
     }
     std::cout << "], ";
-    decl.body->accept(*this);
-    std::cout << ")";
+    if (decl.body) then(decl.body);
+    else std::cout << (decl.pending() ? "Lazy" : "Prototype");
+    then(")");
 }
 
-void PrintVisitor::visit(StructDeclNode& decl) {
-    std::cout << "Struct(" << decl.name << ", [";
+void PrintVisitor::operator()(StructDeclNode& decl) {
+    std::cout << "Struct(" << symbols::name(decl.name) << ", [";
     for (size_t i = 0; i < decl.fields.size(); ++i) {
-        visit(decl.fields[i]);
-        if (i + 1 < decl.fields.size()) std::cout << ", ";
+        then(decl.fields[i]);
+        if (i + 1 < decl.fields.size()) then(", ");
     }
-    std::cout << "])";
+    then("])");
 }
 
-void PrintVisitor::visit(AssertDeclNode& decl) {
+void PrintVisitor::operator()(AssertDeclNode& decl) {
     std::cout << "Assert(";
-    decl.expr->accept(*this);
+    then(decl.expr);
     if (!decl.message.empty()) {
-        std::cout << ", \"" << decl.message << "\"";
+        then(", \"");
+        then(decl.message);
+        then("\"");
     }
-    std::cout << ")";
+    then(")");
 }
 
-void PrintVisitor::visit(ASTRootNode& node) {
+void PrintVisitor::operator()(ASTRootNode& node) {
     std::cout << "Program([" << std::endl;
     for (const auto& stmt : node.statements) {
-        stmt->accept(*this);
-        std::cout << std::endl;
+        then(stmt);
+        then("\n");
     }
-    std::cout << "])" << std::endl;
+    then("])\n");
 }
 
 
@@ -266,7 +307,7 @@ void ForStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void ReturnStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void BreakStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void ContinueStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
-void InStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
+void InputStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void OutStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void SZFStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void ExitStatmNode::accept(ASTVisitor& visitor) { visitor.visit(*this); }
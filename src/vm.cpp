@@ -0,0 +1,440 @@
+#include "vm.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// адреса меток (&&метка) - расширение GNU: переход по таблице из конца каждой инструкции,
+// у каждой инструкции свой косвенный переход, и предсказывается он лучше общего switch
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(VM_SWITCH_DISPATCH)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+namespace {
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error(message);
+}
+
+using values::arithmetic;
+using values::assign;
+using values::to_int;
+using values::to_object;
+using values::truth;
+
+// приведение к скалярному типу - то же, что values::assign в ячейку этого типа
+Value convert(const Value& value, TypeId type) {
+    switch (type) {
+        case types::INT: return to_int(value);
+        case types::FLOAT: return values::to_double(value);
+        case types::CHAR: return static_cast<char>(to_int(value));
+        case types::BOOL: return truth(value);
+        default: return value;
+    }
+}
+
+Value default_value(TypeId type) {
+    switch (type) {
+        case types::INT: return 0;
+        case types::FLOAT: return 0.0;
+        case types::CHAR: return '\0';
+        case types::BOOL: return false;
+        default: return {};
+    }
+}
+
+bool test(const Value& value) {
+    if (value.is_bool()) return value.as_bool();
+    return truth(value);
+}
+
+Object* element_of(const Value& array, const Value& position, int& index) {
+    auto* object = to_object(array);
+    index = to_int(position);
+    if (index < 0 || static_cast<std::size_t>(index) >= object->slots.size())
+        fail("индекс " + std::to_string(index) + " вне массива из " + std::to_string(object->slots.size()));
+    return object;
+}
+
+}
+
+VM::VM(Module& module, std::istream& in, std::ostream& out) :
+    module(module), in(in), out(out), stack(std::make_unique<Value[]>(STACK_SLOTS)) {}
+
+int VM::run(bool count) {
+    globals.assign(module.globals, Value{});
+    frames.clear();
+
+    const Function* fn = &module.functions[module.entry];
+    Value* regs = stack.get();
+    Value* const stack_end = stack.get() + STACK_SLOTS;
+    std::copy(fn->constants.begin(), fn->constants.end(), regs + fn->constant_base);
+    Instr* pc = module.functions[module.entry].code.data();
+    Instr ins;
+    Value returned;
+    int code = 0;
+    std::uint64_t counted = 0;
+
+#define R(operand) regs[ins.operand]
+
+// со счетом все переходы идут через count_dispatch - без счета цикл тот же, что и был
+#if VM_COMPUTED_GOTO
+    static const void* const labels[] = {
+#define VM_LABEL(name, a, b, c) &&op_##name,
+        VM_OPCODES(VM_LABEL)
+#undef VM_LABEL
+    };
+    static const void* const counting[] = {
+#define VM_LABEL(name, a, b, c) &&count_dispatch,
+        VM_OPCODES(VM_LABEL)
+#undef VM_LABEL
+    };
+    const void* const* table = count ? counting : labels;
+#define VM_CASE(name) op_##name
+#define VM_NEXT() do { ins = *pc++; goto *table[static_cast<std::size_t>(ins.op)]; } while (0)
+#else
+#define VM_CASE(name) case Op::name
+#define VM_NEXT() do { ins = *pc++; goto dispatch; } while (0)
+#endif
+
+// инструкция на месте получает другую форму; pc уже за ней
+#define VM_REWRITE(form) (pc[-1].op = (form))
+
+// общая форма: считает через values::arithmetic и переписывает себя в форму по типам операндов
+#define VM_QUICKEN(name, as_int, as_float) \
+    VM_CASE(name): { \
+        const Value& left = R(b); \
+        const Value& right = R(c); \
+        if (left.index() == right.index()) { \
+            if (left.index() == values::INT) VM_REWRITE(as_int); \
+            else if (left.index() == values::DOUBLE) VM_REWRITE(as_float); \
+        } \
+        R(a) = arithmetic(OpKind::name, left, right); \
+        VM_NEXT(); \
+    }
+// формы для int и float: другие типы или особый случай (деление на ноль) - обратно в общую
+// форму и повтор той же инструкции
+#define VM_INT(name, guard, result) \
+    VM_CASE(name##_II): { \
+        if (R(b).is_int() && R(c).is_int()) { \
+            int x = R(b).as_int(), y = R(c).as_int(); \
+            if (guard) { \
+                unsigned l = static_cast<unsigned>(x), r = static_cast<unsigned>(y); \
+                (void)l; (void)r; \
+                R(a) = result; \
+                VM_NEXT(); \
+            } \
+        } \
+        VM_REWRITE(Op::name); \
+        --pc; \
+        VM_NEXT(); \
+    }
+#define VM_FLOAT(name, result) \
+    VM_CASE(name##_FF): { \
+        if (R(b).is_double() && R(c).is_double()) { \
+            double x = R(b).as_double(), y = R(c).as_double(); \
+            R(a) = result; \
+            VM_NEXT(); \
+        } \
+        VM_REWRITE(Op::name); \
+        --pc; \
+        VM_NEXT(); \
+    }
+#define VM_GENERIC(name) \
+    VM_CASE(name): { \
+        R(a) = arithmetic(OpKind::name, R(b), R(c)); \
+        VM_NEXT(); \
+    }
+// сравнение со следующим за ним JMP: переход, если результат не равен c
+#define VM_BRANCH(name, oper) \
+    VM_CASE(JMP_##name): { \
+        const Value& left = R(a); \
+        const Value& right = R(b); \
+        bool taken; \
+        if (left.is_int() && right.is_int()) taken = left.as_int() oper right.as_int(); \
+        else taken = truth(arithmetic(OpKind::name, left, right)); \
+        pc += 1 + (taken != static_cast<bool>(ins.c) ? pc->jump() : 0); \
+        VM_NEXT(); \
+    }
+
+    VM_NEXT();
+#if VM_COMPUTED_GOTO
+count_dispatch:
+    ++counted;
+    goto *labels[static_cast<std::size_t>(ins.op)];
+#else
+dispatch:
+    if (count) ++counted;
+    switch (ins.op) {
+#endif
+    VM_CASE(MOVE): {
+        R(a) = R(b);
+        VM_NEXT();
+    }
+    VM_CASE(STORE): {
+        Value& target = R(a);
+        const Value& source = R(b);
+        if (target.index() == source.index() && target.index() != values::OBJECT) target = source;
+        else assign(target, source);
+        VM_NEXT();
+    }
+    VM_CASE(CAST): {
+        R(a) = convert(R(b), ins.c);
+        VM_NEXT();
+    }
+    VM_CASE(GET_GLOBAL): {
+        R(a) = globals[ins.wide()];
+        VM_NEXT();
+    }
+    VM_CASE(SET_GLOBAL): {
+        assign(globals[ins.wide()], R(a));
+        VM_NEXT();
+    }
+    VM_QUICKEN(ADD, Op::ADD_II, Op::ADD_FF)
+    VM_QUICKEN(SUB, Op::SUB_II, Op::SUB_FF)
+    VM_QUICKEN(MUL, Op::MUL_II, Op::MUL_FF)
+    VM_QUICKEN(DIV, Op::DIV_II, Op::DIV_FF)
+    VM_QUICKEN(MOD, Op::MOD_II, Op::MOD)
+    VM_QUICKEN(EQ, Op::EQ_II, Op::EQ_FF)
+    VM_QUICKEN(NEQ, Op::NEQ_II, Op::NEQ_FF)
+    VM_QUICKEN(LT, Op::LT_II, Op::LT_FF)
+    VM_QUICKEN(GT, Op::GT_II, Op::GT_FF)
+    VM_QUICKEN(LEQ, Op::LEQ_II, Op::LEQ_FF)
+    VM_QUICKEN(GEQ, Op::GEQ_II, Op::GEQ_FF)
+    VM_CASE(AND): {
+        R(a) = truth(R(b)) && truth(R(c));
+        VM_NEXT();
+    }
+    VM_CASE(OR): {
+        R(a) = truth(R(b)) || truth(R(c));
+        VM_NEXT();
+    }
+    VM_CASE(NOT): {
+        R(a) = !truth(R(b));
+        VM_NEXT();
+    }
+    VM_GENERIC(BIT_AND)
+    VM_GENERIC(BIT_OR)
+    VM_GENERIC(BIT_XOR)
+    VM_CASE(BIT_NOT): {
+        R(a) = values::unary(OpKind::BIT_NOT, R(b));
+        VM_NEXT();
+    }
+    VM_GENERIC(SHL)
+    VM_GENERIC(SHR)
+    VM_CASE(NEG): {
+        R(a) = values::unary(OpKind::SUB, R(b));
+        VM_NEXT();
+    }
+    VM_CASE(PLUS): {
+        R(a) = values::unary(OpKind::ADD, R(b));
+        VM_NEXT();
+    }
+    VM_CASE(TEST): {
+        R(a) = test(R(b));
+        VM_NEXT();
+    }
+    VM_CASE(JMP): {
+        pc += ins.jump();
+        VM_NEXT();
+    }
+    VM_CASE(JMP_IF): {
+        if (test(R(a))) pc += ins.jump();
+        VM_NEXT();
+    }
+    VM_CASE(JMP_IFNOT): {
+        if (!test(R(a))) pc += ins.jump();
+        VM_NEXT();
+    }
+    // кадр вызванной - за всем кадром вызывающей, включая ее константы
+    VM_CASE(CALL): {
+        Function& callee = module.functions[ins.b];
+        if (callee.code.empty()) fail("у функции '" + callee.name + "' нет тела");
+        Value* frame = regs + fn->registers;
+        if (frame + callee.registers > stack_end) fail("переполнение стека");
+        std::copy(regs + ins.a, regs + ins.a + ins.c, frame);
+        std::copy(callee.constants.begin(), callee.constants.end(), frame + callee.constant_base);
+        frames.push_back({fn, pc, regs, heap.mark(), ins.a});
+        fn = &callee;
+        regs = frame;
+        pc = callee.code.data();
+        VM_NEXT();
+    }
+    VM_CASE(RET): {
+        returned = R(a);
+        goto leave;
+    }
+    VM_CASE(RET_VOID): {
+        returned = Value{};
+        goto leave;
+    }
+    VM_CASE(GET_FIELD): {
+        R(a) = to_object(R(b))->slots[ins.c];
+        VM_NEXT();
+    }
+    VM_CASE(SET_FIELD): {
+        assign(to_object(R(a))->slots[ins.b], R(c));
+        VM_NEXT();
+    }
+    VM_CASE(GET_INDEX): {
+        int index;
+        auto* array = element_of(R(b), R(c), index);
+        R(a) = array->slots[index];
+        VM_NEXT();
+    }
+    VM_CASE(SET_INDEX): {
+        int index;
+        auto* array = element_of(R(a), R(b), index);
+        assign(array->slots[index], R(c));
+        VM_NEXT();
+    }
+    VM_CASE(NEW_ARRAY): {
+        int size = to_int(R(b));
+        if (size < 0) fail("отрицательный размер массива");
+        auto* array = heap.allocate(size);
+        if (ins.c != NO_TYPE) std::fill(array->slots.begin(), array->slots.end(), default_value(ins.c));
+        R(a) = array;
+        VM_NEXT();
+    }
+    VM_CASE(NEW_OBJECT): {
+        R(a) = heap.allocate(ins.b);
+        VM_NEXT();
+    }
+    VM_CASE(MARK): {
+        R(a) = static_cast<int>(heap.mark());
+        VM_NEXT();
+    }
+    VM_CASE(RELEASE): {
+        heap.release(static_cast<std::size_t>(R(a).as_int()));
+        VM_NEXT();
+    }
+    VM_CASE(READ): {
+        if (!values::read(in, R(a))) fail("не удалось прочитать значение");
+        VM_NEXT();
+    }
+    VM_CASE(PRINT): {
+        values::print(out, R(a));
+        out << '\n';
+        VM_NEXT();
+    }
+    VM_CASE(NEWLINE): {
+        out << '\n';
+        VM_NEXT();
+    }
+    VM_CASE(SIZEOF): {
+        R(a) = values::size_of(R(b));
+        VM_NEXT();
+    }
+    VM_CASE(EXIT): {
+        code = to_int(R(a));
+        goto finish;
+    }
+    VM_CASE(ASSERT): {
+        if (truth(R(a))) VM_NEXT();
+        std::string message = "ассерт не выполнен";
+        auto text = module.messages[ins.wide()];
+        if (!text.empty()) message += ": " + std::string(text);
+        fail(message);
+    }
+    VM_BRANCH(EQ, ==)
+    VM_BRANCH(NEQ, !=)
+    VM_BRANCH(LT, <)
+    VM_BRANCH(GT, >)
+    VM_BRANCH(LEQ, <=)
+    VM_BRANCH(GEQ, >=)
+    VM_CASE(ADD_STORE): {
+        Value& target = R(a);
+        const Value& left = R(b);
+        const Value& right = R(c);
+        if (target.is_int() && left.is_int() && right.is_int()) {
+            target = static_cast<int>(static_cast<unsigned>(left.as_int()) + static_cast<unsigned>(right.as_int()));
+        } else if (target.is_double() && left.is_double() && right.is_double()) {
+            target = left.as_double() + right.as_double();
+        } else {
+            assign(target, arithmetic(OpKind::ADD, left, right));
+        }
+        VM_NEXT();
+    }
+    VM_CASE(INC_LOCAL): {
+        Value& target = R(a);
+        int step = static_cast<std::int16_t>(ins.b);
+        if (target.is_int())
+            target = static_cast<int>(static_cast<unsigned>(target.as_int()) + static_cast<unsigned>(step));
+        else
+            assign(target, arithmetic(OpKind::ADD, target, step));
+        VM_NEXT();
+    }
+    VM_INT(ADD, true, static_cast<int>(l + r))
+    VM_INT(SUB, true, static_cast<int>(l - r))
+    VM_INT(MUL, true, static_cast<int>(l * r))
+    VM_INT(DIV, y != 0 && (y != -1 || x != INT_MIN), x / y)
+    VM_INT(MOD, y != 0 && (y != -1 || x != INT_MIN), x % y)
+    VM_INT(EQ, true, x == y)
+    VM_INT(NEQ, true, x != y)
+    VM_INT(LT, true, x < y)
+    VM_INT(GT, true, x > y)
+    VM_INT(LEQ, true, x <= y)
+    VM_INT(GEQ, true, x >= y)
+    VM_FLOAT(ADD, x + y)
+    VM_FLOAT(SUB, x - y)
+    VM_FLOAT(MUL, x * y)
+    VM_FLOAT(DIV, x / y)
+    VM_FLOAT(EQ, x == y)
+    VM_FLOAT(NEQ, x != y)
+    VM_FLOAT(LT, x < y)
+    VM_FLOAT(GT, x > y)
+    VM_FLOAT(LEQ, x <= y)
+    VM_FLOAT(GEQ, x >= y)
+#if !VM_COMPUTED_GOTO
+    }
+#endif
+
+// выход из функции: результат приводится к ее типу, созданное за вызов в куче освобождается,
+// кроме возвращенной структуры - она копируется в область вызывающей. конструктор оставляет все
+leave: {
+    if (frames.empty()) {
+        code = returned.index() == values::NOTHING ? 0 : to_int(returned);
+        goto finish;
+    }
+    Frame caller = frames.back();
+    frames.pop_back();
+    auto type = fn->result;
+    if (type == types::VOID) {
+        returned = Value{};
+        heap.release(caller.heap_mark);
+    } else if (type >= types::STRUCT) {
+        if (!fn->constructor) {
+            auto kept = heap.mark();
+            returned = heap.clone(*to_object(returned));
+            heap.release(caller.heap_mark, kept);
+        }
+    } else {
+        returned = returned.index() == values::NOTHING ? default_value(type) : convert(returned, type);
+        heap.release(caller.heap_mark);
+    }
+    fn = caller.function;
+    regs = caller.registers;
+    pc = caller.pc;
+    regs[caller.result] = std::move(returned);
+    VM_NEXT();
+}
+
+finish:
+    dispatched = counted;
+    out.flush();
+    return code;
+
+#undef VM_BRANCH
+#undef VM_GENERIC
+#undef VM_FLOAT
+#undef VM_INT
+#undef VM_QUICKEN
+#undef VM_REWRITE
+#undef VM_NEXT
+#undef VM_CASE
+#undef R
+}